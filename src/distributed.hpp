@@ -0,0 +1,931 @@
+// INFO: multi-process execution over Unix/TCP sockets or POSIX shared memory (Linux/POSIX only).
+// INFO: rank 0 is the coordinator and every other rank is a worker connected to it, collectives are
+// INFO: relayed through the coordinator. Messages are raw bytes, so all processes must share one architecture.
+
+#ifndef DISTRIBUTED_HPP
+#define DISTRIBUTED_HPP
+
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <stdexcept>
+#include <atomic>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define DISTRIBUTED_TILE 256 // INFO: default tile edge of the block-cyclic distribution
+#define DISTRIBUTED_BIND_ADDRESS "127.0.0.1" // INFO: default interface of Communicator::listen, workers must be local
+
+#ifdef MSG_NOSIGNAL
+#define DISTRIBUTED_SEND_FLAGS MSG_NOSIGNAL
+#else
+#define DISTRIBUTED_SEND_FLAGS 0
+#endif
+
+enum class Transport
+{
+        SOCKET,       // INFO: tiles are streamed through the sockets, computation overlaps with the transfer
+        SHARED_MEMORY // INFO: operands are placed in one POSIX shared memory segment, workers only exchange signals
+};
+
+struct DistributedOptions
+{
+        Transport transport = Transport::SOCKET;
+        uint64_t tile = DISTRIBUTED_TILE;
+        uint32_t gridRows = 0; // INFO: 0 picks the most square process grid
+        uint32_t gridCols = 0;
+};
+
+class Channel
+{
+private:
+        int mSocket = -1;
+
+public:
+        Channel() = default;
+        explicit Channel(int socket) : mSocket(socket) {}
+        Channel(const Channel &) = delete;
+        Channel(Channel &&channel) : mSocket(channel.mSocket)
+        {
+                channel.mSocket = -1;
+        }
+
+        ~Channel()
+        {
+                close();
+        }
+
+        Channel &operator=(const Channel &) = delete;
+        Channel &operator=(Channel &&channel)
+        {
+                if (this != &channel)
+                {
+                        close();
+                        mSocket = channel.mSocket;
+                        channel.mSocket = -1;
+                }
+                return *this;
+        }
+
+        void close()
+        {
+                if (mSocket >= 0)
+                        ::close(mSocket);
+                mSocket = -1;
+        }
+
+        void send(const void *data, uint64_t bytes) const
+        {
+                const char *pointer = static_cast<const char *>(data);
+                while (bytes > 0)
+                {
+                        ssize_t sent = ::send(mSocket, pointer, bytes, DISTRIBUTED_SEND_FLAGS);
+                        if (sent < 0 && errno == EINTR)
+                                continue;
+                        if (sent <= 0)
+                                throw std::runtime_error("Failed to send on channel.");
+                        pointer += sent;
+                        bytes -= sent;
+                }
+        }
+
+        // INFO: returns false when the peer closed the channel before the first byte
+        bool tryReceive(void *data, uint64_t bytes) const
+        {
+                char *pointer = static_cast<char *>(data);
+                uint64_t total = bytes;
+                while (bytes > 0)
+                {
+                        ssize_t received = ::recv(mSocket, pointer, bytes, 0);
+                        if (received < 0 && errno == EINTR)
+                                continue;
+                        if (received == 0 && bytes == total)
+                                return false;
+                        if (received <= 0)
+                                throw std::runtime_error("Failed to receive on channel.");
+                        pointer += received;
+                        bytes -= received;
+                }
+                return true;
+        }
+
+        void receive(void *data, uint64_t bytes) const
+        {
+                if (!tryReceive(data, bytes))
+                        throw std::runtime_error("Channel closed by peer.");
+        }
+
+        template <typename V>
+        void sendValue(const V &value) const
+        {
+                send(&value, sizeof(V));
+        }
+
+        template <typename V>
+        V receiveValue() const
+        {
+                V value;
+                receive(&value, sizeof(V));
+                return value;
+        }
+};
+
+class SharedMemory
+{
+private:
+        std::string mName;
+        void *mAddress = nullptr;
+        uint64_t mBytes = 0;
+        bool mOwner = false;
+
+        SharedMemory(const std::string &name, uint64_t bytes, bool create) : mName(name), mBytes(bytes), mOwner(create)
+        {
+                int descriptor = create ? shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600) : shm_open(name.c_str(), O_RDWR, 0600);
+                if (descriptor < 0)
+                        throw std::runtime_error("Failed to open shared memory segment " + name + ".");
+                if (create && ftruncate(descriptor, bytes) != 0)
+                {
+                        ::close(descriptor);
+                        shm_unlink(name.c_str());
+                        throw std::runtime_error("Failed to size shared memory segment " + name + ".");
+                }
+                mAddress = mmap(nullptr, (bytes == 0) ? 1 : bytes, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+                ::close(descriptor);
+                if (mAddress == MAP_FAILED)
+                {
+                        mAddress = nullptr;
+                        if (create)
+                                shm_unlink(name.c_str());
+                        throw std::runtime_error("Failed to map shared memory segment " + name + ".");
+                }
+        }
+
+public:
+        SharedMemory(const SharedMemory &) = delete;
+        SharedMemory &operator=(const SharedMemory &) = delete;
+
+        ~SharedMemory()
+        {
+                if (mAddress != nullptr)
+                        munmap(mAddress, (mBytes == 0) ? 1 : mBytes);
+                if (mOwner)
+                        shm_unlink(mName.c_str());
+        }
+
+        static SharedMemory create(const std::string &name, uint64_t bytes)
+        {
+                return SharedMemory(name, bytes, true);
+        }
+
+        static SharedMemory open(const std::string &name, uint64_t bytes)
+        {
+                return SharedMemory(name, bytes, false);
+        }
+
+        SharedMemory(SharedMemory &&memory) : mName(memory.mName), mAddress(memory.mAddress), mBytes(memory.mBytes), mOwner(memory.mOwner)
+        {
+                memory.mAddress = nullptr;
+                memory.mOwner = false;
+        }
+
+        void *data() const
+        {
+                return mAddress;
+        }
+
+        uint64_t size() const
+        {
+                return mBytes;
+        }
+};
+
+class Communicator
+{
+private:
+        uint32_t mRank = 0;
+        uint32_t mSize = 1;
+        std::vector<Channel> mChannels; // INFO: coordinator holds one channel per worker, a worker holds one to the coordinator
+        std::vector<pid_t> mChildren;
+
+        static Communicator acceptWorkers(int listener, uint32_t numWorkers)
+        {
+                Communicator result;
+                result.mSize = numWorkers + 1;
+                for (uint32_t i = 0; i < numWorkers; i++)
+                {
+                        int socket = ::accept(listener, nullptr, nullptr);
+                        if (socket < 0)
+                        {
+                                ::close(listener);
+                                throw std::runtime_error("Failed to accept worker connection.");
+                        }
+                        result.mChannels.emplace_back(socket);
+                        result.mChannels.back().sendValue<uint32_t>(i + 1);
+                        result.mChannels.back().sendValue<uint32_t>(result.mSize);
+                }
+                ::close(listener);
+                return result;
+        }
+
+        static Communicator joinCoordinator(int socket)
+        {
+                Communicator result;
+                result.mChannels.emplace_back(socket);
+                result.mRank = result.mChannels[0].receiveValue<uint32_t>();
+                result.mSize = result.mChannels[0].receiveValue<uint32_t>();
+                return result;
+        }
+
+        const Channel &channel(uint32_t rank) const
+        {
+                if (mRank == 0)
+                {
+                        if (rank == 0 || rank >= mSize)
+                                throw std::runtime_error("Invalid destination rank.");
+                        return mChannels[rank - 1];
+                }
+                if (rank != 0)
+                        throw std::runtime_error("Workers can only exchange messages with the coordinator.");
+                return mChannels[0];
+        }
+
+public:
+        Communicator() = default;
+        Communicator(const Communicator &) = delete;
+        Communicator(Communicator &&) = default;
+        Communicator &operator=(const Communicator &) = delete;
+        Communicator &operator=(Communicator &&) = default;
+
+        // INFO: closing the channels lets serving workers return before the coordinator reaps them
+        ~Communicator()
+        {
+                mChannels.clear();
+                wait();
+        }
+
+        // INFO: forks numWorkers processes connected through socket pairs, each runs worker and exits;
+        // INFO: call it before starting any threads in the parent process
+        static Communicator spawn(uint32_t numWorkers, const std::function<void(Communicator &)> &worker)
+        {
+                Communicator result;
+                result.mSize = numWorkers + 1;
+                for (uint32_t i = 0; i < numWorkers; i++)
+                {
+                        int sockets[2];
+                        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0)
+                                throw std::runtime_error("Failed to create socket pair.");
+                        pid_t pid = fork();
+                        if (pid < 0)
+                                throw std::runtime_error("Failed to fork worker process.");
+                        if (pid == 0)
+                        {
+                                ::close(sockets[0]);
+                                result.mChannels.clear();
+                                int status = 0;
+                                try
+                                {
+                                        Communicator child;
+                                        child.mRank = i + 1;
+                                        child.mSize = numWorkers + 1;
+                                        child.mChannels.emplace_back(sockets[1]);
+                                        worker(child);
+                                }
+                                catch (const std::exception &exception)
+                                {
+                                        std::cerr << "Worker " << i + 1 << ": " << exception.what() << "\n";
+                                        status = 1;
+                                }
+                                _exit(status);
+                        }
+                        ::close(sockets[1]);
+                        result.mChannels.emplace_back(sockets[0]);
+                        result.mChildren.push_back(pid);
+                }
+                return result;
+        }
+
+        // INFO: the protocol is unauthenticated, so only bind to an interface other than loopback (e.g. "0.0.0.0")
+        // INFO: on a trusted network, any peer that connects first is accepted as a worker
+        static Communicator listen(uint16_t port, uint32_t numWorkers, const std::string &host = DISTRIBUTED_BIND_ADDRESS)
+        {
+                addrinfo hints = {};
+                hints.ai_family = AF_INET;
+                hints.ai_socktype = SOCK_STREAM;
+                hints.ai_flags = AI_PASSIVE;
+                addrinfo *addresses = nullptr;
+                if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+                        throw std::runtime_error("Failed to resolve " + host + ".");
+                int listener = socket(AF_INET, SOCK_STREAM, 0);
+                if (listener < 0)
+                {
+                        freeaddrinfo(addresses);
+                        throw std::runtime_error("Failed to create socket.");
+                }
+                int enable = 1;
+                setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+                bool bound = bind(listener, addresses->ai_addr, addresses->ai_addrlen) == 0;
+                freeaddrinfo(addresses);
+                if (!bound || ::listen(listener, numWorkers) != 0)
+                {
+                        ::close(listener);
+                        throw std::runtime_error("Failed to listen on " + host + ":" + std::to_string(port) + ".");
+                }
+                return acceptWorkers(listener, numWorkers);
+        }
+
+        static Communicator connect(const std::string &host, uint16_t port)
+        {
+                addrinfo hints = {};
+                hints.ai_family = AF_INET;
+                hints.ai_socktype = SOCK_STREAM;
+                addrinfo *addresses = nullptr;
+                if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+                        throw std::runtime_error("Failed to resolve " + host + ".");
+                int socket = ::socket(AF_INET, SOCK_STREAM, 0);
+                if (socket < 0 || ::connect(socket, addresses->ai_addr, addresses->ai_addrlen) != 0)
+                {
+                        freeaddrinfo(addresses);
+                        if (socket >= 0)
+                                ::close(socket);
+                        throw std::runtime_error("Failed to connect to " + host + ":" + std::to_string(port) + ".");
+                }
+                freeaddrinfo(addresses);
+                int enable = 1;
+                setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+                return joinCoordinator(socket);
+        }
+
+        static Communicator listenUnix(const std::string &path, uint32_t numWorkers)
+        {
+                int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+                sockaddr_un address = {};
+                address.sun_family = AF_UNIX;
+                if (listener < 0 || path.size() >= sizeof(address.sun_path))
+                        throw std::runtime_error("Failed to create socket at " + path + ".");
+                std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+                unlink(path.c_str());
+                if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || ::listen(listener, numWorkers) != 0)
+                {
+                        ::close(listener);
+                        throw std::runtime_error("Failed to listen at " + path + ".");
+                }
+                Communicator result = acceptWorkers(listener, numWorkers);
+                unlink(path.c_str());
+                return result;
+        }
+
+        static Communicator connectUnix(const std::string &path)
+        {
+                int socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+                sockaddr_un address = {};
+                address.sun_family = AF_UNIX;
+                if (socket < 0 || path.size() >= sizeof(address.sun_path))
+                        throw std::runtime_error("Failed to create socket for " + path + ".");
+                std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+                if (::connect(socket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+                {
+                        ::close(socket);
+                        throw std::runtime_error("Failed to connect to " + path + ".");
+                }
+                return joinCoordinator(socket);
+        }
+
+        uint32_t rank() const
+        {
+                return mRank;
+        }
+
+        uint32_t size() const
+        {
+                return mSize;
+        }
+
+        bool isCoordinator() const
+        {
+                return mRank == 0;
+        }
+
+        // INFO: reaps spawned workers, returns false if any of them failed
+        bool wait()
+        {
+                bool success = true;
+                for (pid_t child : mChildren)
+                {
+                        int status = 0;
+                        if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                                success = false;
+                }
+                mChildren.clear();
+                return success;
+        }
+
+        void send(uint32_t rank, const void *data, uint64_t bytes) const
+        {
+                channel(rank).send(data, bytes);
+        }
+
+        void receive(uint32_t rank, void *data, uint64_t bytes) const
+        {
+                channel(rank).receive(data, bytes);
+        }
+
+        bool tryReceive(uint32_t rank, void *data, uint64_t bytes) const
+        {
+                return channel(rank).tryReceive(data, bytes);
+        }
+
+        void barrier() const
+        {
+                uint8_t token = 0;
+                if (mRank != 0)
+                {
+                        send(0, &token, 1);
+                        receive(0, &token, 1);
+                        return;
+                }
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                        receive(rank, &token, 1);
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                        send(rank, &token, 1);
+        }
+
+        template <typename T>
+        void broadcast(T *data, uint64_t count, uint32_t root = 0) const
+        {
+                uint64_t bytes = count*sizeof(T);
+                if (mRank != 0)
+                {
+                        if (mRank == root)
+                                send(0, data, bytes);
+                        else
+                                receive(0, data, bytes);
+                        return;
+                }
+                if (root != 0)
+                        receive(root, data, bytes);
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                {
+                        if (rank != root)
+                                send(rank, data, bytes);
+                }
+        }
+
+        // INFO: element-wise sum, contributions are added in rank order so the result is deterministic
+        template <typename T>
+        void reduce(const T *data, T *result, uint64_t count, uint32_t root = 0) const
+        {
+                uint64_t bytes = count*sizeof(T);
+                if (mRank != 0)
+                {
+                        send(0, data, bytes);
+                        if (mRank == root)
+                                receive(0, result, bytes);
+                        return;
+                }
+                std::vector<T> total(data, data + count);
+                std::vector<T> buffer(count);
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                {
+                        receive(rank, buffer.data(), bytes);
+                        for (uint64_t i = 0; i < count; i++)
+                                total[i] += buffer[i];
+                }
+                if (root == 0)
+                        std::copy(total.begin(), total.end(), result);
+                else
+                        send(root, total.data(), bytes);
+        }
+
+        template <typename T>
+        void allReduce(const T *data, T *result, uint64_t count) const
+        {
+                reduce(data, result, count, 0);
+                broadcast(result, count, 0);
+        }
+
+        // INFO: result receives count elements from every rank, ordered by rank
+        template <typename T>
+        void allGather(const T *data, T *result, uint64_t count) const
+        {
+                uint64_t bytes = count*sizeof(T);
+                if (mRank != 0)
+                {
+                        send(0, data, bytes);
+                        receive(0, result, bytes*mSize);
+                        return;
+                }
+                std::copy(data, data + count, result);
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                        receive(rank, result + rank*count, bytes);
+                for (uint32_t rank = 1; rank < mSize; rank++)
+                        send(rank, result, bytes*mSize);
+        }
+};
+
+template <typename T>
+struct DistributedType;
+
+template <>
+struct DistributedType<float>
+{
+        static constexpr uint32_t code = 1;
+};
+
+template <>
+struct DistributedType<double>
+{
+        static constexpr uint32_t code = 2;
+};
+
+template <>
+struct DistributedType<int32_t>
+{
+        static constexpr uint32_t code = 3;
+};
+
+template <>
+struct DistributedType<int64_t>
+{
+        static constexpr uint32_t code = 4;
+};
+
+#define DISTRIBUTED_COMMAND_STOP 0
+#define DISTRIBUTED_COMMAND_GEMM 1
+
+struct DistributedJob
+{
+        uint32_t command;
+        uint32_t type;
+        uint32_t transport;
+        uint32_t gridRows;
+        uint32_t gridCols;
+        uint64_t rows;
+        uint64_t inner;
+        uint64_t cols;
+        uint64_t tile;
+        char segment[64];
+};
+
+// INFO: tiles of the 2D block-cyclic distribution, tile (I, J) of the result belongs to worker
+// INFO: (I % gridRows)*gridCols + (J % gridCols) + 1
+struct DistributedTiling
+{
+        uint64_t tile;
+        uint64_t tileRows;
+        uint64_t tileInner;
+        uint64_t tileCols;
+        std::vector<uint64_t> rowTiles;
+        std::vector<uint64_t> colTiles;
+
+        DistributedTiling(const DistributedJob &job, uint32_t worker) : tile(job.tile)
+        {
+                tileRows = (job.rows + tile - 1) / tile;
+                tileInner = (job.inner + tile - 1) / tile;
+                tileCols = (job.cols + tile - 1) / tile;
+                for (uint64_t i = worker / job.gridCols; i < tileRows; i += job.gridRows)
+                        rowTiles.push_back(i);
+                for (uint64_t j = worker % job.gridCols; j < tileCols; j += job.gridCols)
+                        colTiles.push_back(j);
+        }
+
+        static uint64_t extent(uint64_t index, uint64_t tile, uint64_t size)
+        {
+                return std::min(tile, size - index*tile);
+        }
+
+        bool empty() const
+        {
+                return rowTiles.empty() || colTiles.empty();
+        }
+};
+
+// INFO: c (m x n, leading dimension ldc) += a (m x k) * b (k x n), all row-major
+template <typename T>
+void gemmTile(const T *a, uint64_t lda, const T *b, uint64_t ldb, T *c, uint64_t ldc, uint64_t m, uint64_t k, uint64_t n)
+{
+        for (uint64_t i = 0; i < m; i++)
+        {
+                for (uint64_t p = 0; p < k; p++)
+                {
+                        T value = a[i*lda + p];
+                        for (uint64_t j = 0; j < n; j++)
+                                c[i*ldc + j] += value * b[p*ldb + j];
+                }
+        }
+}
+
+template <typename T>
+void packTile(const T *source, uint64_t stride, uint64_t row, uint64_t col, uint64_t height, uint64_t width, T *destination)
+{
+        for (uint64_t i = 0; i < height; i++)
+                std::copy(source + (row + i)*stride + col, source + (row + i)*stride + col + width, destination + i*width);
+}
+
+// INFO: one panel per k step holds the A tiles of the worker's tile rows followed by the B tiles of its tile cols
+template <typename T>
+std::vector<T> packPanel(const DistributedJob &job, const DistributedTiling &tiling, uint64_t k, const T *a, const T *b)
+{
+        uint64_t depth = DistributedTiling::extent(k, job.tile, job.inner);
+        std::vector<T> panel;
+        for (uint64_t i : tiling.rowTiles)
+        {
+                uint64_t offset = panel.size();
+                uint64_t height = DistributedTiling::extent(i, job.tile, job.rows);
+                panel.resize(offset + height*depth);
+                packTile(a, job.inner, i*job.tile, k*job.tile, height, depth, panel.data() + offset);
+        }
+        for (uint64_t j : tiling.colTiles)
+        {
+                uint64_t offset = panel.size();
+                uint64_t width = DistributedTiling::extent(j, job.tile, job.cols);
+                panel.resize(offset + depth*width);
+                packTile(b, job.cols, k*job.tile, j*job.tile, depth, width, panel.data() + offset);
+        }
+        return panel;
+}
+
+template <typename T>
+uint64_t panelSize(const DistributedJob &job, const DistributedTiling &tiling, uint64_t k)
+{
+        uint64_t depth = DistributedTiling::extent(k, job.tile, job.inner);
+        uint64_t size = 0;
+        for (uint64_t i : tiling.rowTiles)
+                size += DistributedTiling::extent(i, job.tile, job.rows)*depth;
+        for (uint64_t j : tiling.colTiles)
+                size += depth*DistributedTiling::extent(j, job.tile, job.cols);
+        return size;
+}
+
+template <typename T>
+void distributedGemmSocketWorker(const Communicator &communicator, const DistributedJob &job, const DistributedTiling &tiling)
+{
+        std::vector<std::vector<T>> results;
+        for (uint64_t i : tiling.rowTiles)
+        {
+                for (uint64_t j : tiling.colTiles)
+                        results.emplace_back(DistributedTiling::extent(i, job.tile, job.rows)*DistributedTiling::extent(j, job.tile, job.cols), T(0));
+        }
+
+        // INFO: the receiver thread pulls panel k + 1 from the socket while panel k is being multiplied
+        std::deque<std::vector<T>> panels;
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::exception_ptr failure;
+        std::thread receiver([&]()
+        {
+                try
+                {
+                        for (uint64_t k = 0; k < tiling.tileInner; k++)
+                        {
+                                std::vector<T> panel(panelSize<T>(job, tiling, k));
+                                communicator.receive(0, panel.data(), panel.size()*sizeof(T));
+                                std::lock_guard<std::mutex> lock(mutex);
+                                panels.push_back(std::move(panel));
+                                ready.notify_one();
+                        }
+                }
+                catch (...)
+                {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        failure = std::current_exception();
+                        ready.notify_one();
+                }
+        });
+
+        for (uint64_t k = 0; k < tiling.tileInner; k++)
+        {
+                std::vector<T> panel;
+                {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        ready.wait(lock, [&]() { return !panels.empty() || failure; });
+                        if (panels.empty())
+                                break;
+                        panel = std::move(panels.front());
+                        panels.pop_front();
+                }
+                uint64_t depth = DistributedTiling::extent(k, job.tile, job.inner);
+                std::vector<const T *> aTiles;
+                std::vector<const T *> bTiles;
+                const T *pointer = panel.data();
+                for (uint64_t i : tiling.rowTiles)
+                {
+                        aTiles.push_back(pointer);
+                        pointer += DistributedTiling::extent(i, job.tile, job.rows)*depth;
+                }
+                for (uint64_t j : tiling.colTiles)
+                {
+                        bTiles.push_back(pointer);
+                        pointer += depth*DistributedTiling::extent(j, job.tile, job.cols);
+                }
+                uint64_t index = 0;
+                for (uint64_t x = 0; x < tiling.rowTiles.size(); x++)
+                {
+                        uint64_t height = DistributedTiling::extent(tiling.rowTiles[x], job.tile, job.rows);
+                        for (uint64_t y = 0; y < tiling.colTiles.size(); y++)
+                        {
+                                uint64_t width = DistributedTiling::extent(tiling.colTiles[y], job.tile, job.cols);
+                                gemmTile(aTiles[x], depth, bTiles[y], width, results[index++].data(), width, height, depth, width);
+                        }
+                }
+        }
+        receiver.join();
+        if (failure)
+                std::rethrow_exception(failure);
+        for (const std::vector<T> &result : results)
+                communicator.send(0, result.data(), result.size()*sizeof(T));
+}
+
+template <typename T>
+void distributedGemmSharedWorker(const Communicator &communicator, const DistributedJob &job, const DistributedTiling &tiling)
+{
+        uint64_t bytes = (job.rows*job.inner + job.inner*job.cols + job.rows*job.cols)*sizeof(T);
+        SharedMemory memory = SharedMemory::open(job.segment, bytes);
+        const T *a = static_cast<const T *>(memory.data());
+        const T *b = a + job.rows*job.inner;
+        T *c = static_cast<T *>(memory.data()) + job.rows*job.inner + job.inner*job.cols;
+        for (uint64_t i : tiling.rowTiles)
+        {
+                uint64_t height = DistributedTiling::extent(i, job.tile, job.rows);
+                for (uint64_t j : tiling.colTiles)
+                {
+                        uint64_t width = DistributedTiling::extent(j, job.tile, job.cols);
+                        T *block = c + i*job.tile*job.cols + j*job.tile;
+                        for (uint64_t k = 0; k < tiling.tileInner; k++)
+                        {
+                                uint64_t depth = DistributedTiling::extent(k, job.tile, job.inner);
+                                gemmTile(a + i*job.tile*job.inner + k*job.tile, job.inner, b + k*job.tile*job.cols + j*job.tile, job.cols, block, job.cols, height, depth, width);
+                        }
+                }
+        }
+        uint8_t done = 1;
+        communicator.send(0, &done, 1);
+}
+
+template <typename T>
+void distributedGemmWorker(const Communicator &communicator, const DistributedJob &job)
+{
+        DistributedTiling tiling(job, communicator.rank() - 1);
+        if (tiling.empty())
+        {
+                if (job.transport == static_cast<uint32_t>(Transport::SHARED_MEMORY))
+                {
+                        uint8_t done = 1;
+                        communicator.send(0, &done, 1);
+                }
+                return;
+        }
+        if (job.transport == static_cast<uint32_t>(Transport::SHARED_MEMORY))
+                distributedGemmSharedWorker<T>(communicator, job, tiling);
+        else
+                distributedGemmSocketWorker<T>(communicator, job, tiling);
+}
+
+// INFO: worker loop, executes jobs sent by the coordinator until it calls distributedStop or disconnects
+inline void distributedServe(const Communicator &communicator)
+{
+        if (communicator.isCoordinator())
+                throw std::runtime_error("The coordinator cannot serve jobs.");
+        DistributedJob job;
+        while (communicator.tryReceive(0, &job, sizeof(job)))
+        {
+                if (job.command == DISTRIBUTED_COMMAND_STOP)
+                        return;
+                if (job.command != DISTRIBUTED_COMMAND_GEMM)
+                        throw std::runtime_error("Unknown distributed command.");
+                switch (job.type)
+                {
+                case DistributedType<float>::code:
+                        distributedGemmWorker<float>(communicator, job);
+                        break;
+                case DistributedType<double>::code:
+                        distributedGemmWorker<double>(communicator, job);
+                        break;
+                case DistributedType<int32_t>::code:
+                        distributedGemmWorker<int32_t>(communicator, job);
+                        break;
+                case DistributedType<int64_t>::code:
+                        distributedGemmWorker<int64_t>(communicator, job);
+                        break;
+                default:
+                        throw std::runtime_error("Unknown distributed element type.");
+                }
+        }
+}
+
+inline void distributedStop(const Communicator &communicator)
+{
+        DistributedJob job = {};
+        job.command = DISTRIBUTED_COMMAND_STOP;
+        for (uint32_t rank = 1; rank < communicator.size(); rank++)
+                communicator.send(rank, &job, sizeof(job));
+}
+
+// INFO: c = a*b for row-major a (rows x inner) and b (inner x cols), called on the coordinator while
+// INFO: the workers run distributedServe; without workers the product is computed locally
+template <typename T>
+void distributedMultiply(const Communicator &communicator, const T *a, const T *b, T *c, uint64_t rows, uint64_t inner, uint64_t cols, const DistributedOptions &options = DistributedOptions())
+{
+        if (!communicator.isCoordinator())
+                throw std::runtime_error("Only the coordinator can start a distributed multiply.");
+        std::fill(c, c + rows*cols, T(0));
+        uint32_t numWorkers = communicator.size() - 1;
+        if (numWorkers == 0 || rows == 0 || cols == 0)
+        {
+                gemmTile(a, inner, b, cols, c, cols, rows, inner, cols);
+                return;
+        }
+
+        DistributedJob job = {};
+        job.command = DISTRIBUTED_COMMAND_GEMM;
+        job.type = DistributedType<T>::code;
+        job.transport = static_cast<uint32_t>(options.transport);
+        job.rows = rows;
+        job.inner = inner;
+        job.cols = cols;
+        job.tile = (options.tile == 0) ? DISTRIBUTED_TILE : options.tile;
+        job.gridRows = options.gridRows;
+        job.gridCols = options.gridCols;
+        if (job.gridRows == 0 || job.gridCols == 0)
+        {
+                job.gridRows = static_cast<uint32_t>(std::sqrt(static_cast<double>(numWorkers)));
+                while (numWorkers % job.gridRows != 0)
+                        job.gridRows--;
+                job.gridCols = numWorkers / job.gridRows;
+        }
+        if (uint64_t(job.gridRows)*job.gridCols != numWorkers)
+                throw std::runtime_error("Process grid must contain exactly one cell per worker.");
+
+        std::vector<DistributedTiling> tilings;
+        for (uint32_t worker = 0; worker < numWorkers; worker++)
+                tilings.emplace_back(job, worker);
+
+        if (options.transport == Transport::SHARED_MEMORY)
+        {
+                static std::atomic<uint64_t> counter(0);
+                std::string name = "/totality-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+                std::strncpy(job.segment, name.c_str(), sizeof(job.segment) - 1);
+                SharedMemory memory = SharedMemory::create(name, (rows*inner + inner*cols + rows*cols)*sizeof(T));
+                T *shared = static_cast<T *>(memory.data());
+                std::copy(a, a + rows*inner, shared);
+                std::copy(b, b + inner*cols, shared + rows*inner);
+                std::fill(shared + rows*inner + inner*cols, shared + rows*inner + inner*cols + rows*cols, T(0));
+                for (uint32_t rank = 1; rank <= numWorkers; rank++)
+                        communicator.send(rank, &job, sizeof(job));
+                uint8_t done;
+                for (uint32_t rank = 1; rank <= numWorkers; rank++)
+                        communicator.receive(rank, &done, 1);
+                std::copy(shared + rows*inner + inner*cols, shared + rows*inner + inner*cols + rows*cols, c);
+                return;
+        }
+
+        for (uint32_t rank = 1; rank <= numWorkers; rank++)
+                communicator.send(rank, &job, sizeof(job));
+        // INFO: panels go out k step by k step so every worker can start on step 0 while later steps are in flight
+        for (uint64_t k = 0; k < tilings[0].tileInner; k++)
+        {
+                for (uint32_t worker = 0; worker < numWorkers; worker++)
+                {
+                        if (tilings[worker].empty())
+                                continue;
+                        std::vector<T> panel = packPanel(job, tilings[worker], k, a, b);
+                        communicator.send(worker + 1, panel.data(), panel.size()*sizeof(T));
+                }
+        }
+        std::vector<T> tile(job.tile*job.tile);
+        for (uint32_t worker = 0; worker < numWorkers; worker++)
+        {
+                for (uint64_t i : tilings[worker].rowTiles)
+                {
+                        uint64_t height = DistributedTiling::extent(i, job.tile, rows);
+                        for (uint64_t j : tilings[worker].colTiles)
+                        {
+                                uint64_t width = DistributedTiling::extent(j, job.tile, cols);
+                                communicator.receive(worker + 1, tile.data(), height*width*sizeof(T));
+                                for (uint64_t row = 0; row < height; row++)
+                                        std::copy(tile.data() + row*width, tile.data() + (row + 1)*width, c + (i*job.tile + row)*cols + j*job.tile);
+                        }
+                }
+        }
+}
+
+#endif // DISTRIBUTED_HPP
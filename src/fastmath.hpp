@@ -0,0 +1,450 @@
+// INFO: array-wide transcendental functions written as branch-free float kernels that the compiler vectorizes.
+// INFO: every function takes a MathAccuracy, the documented error bounds are the maximum measured against
+// INFO: libm (computed in double) over each function's useful float domain, tests/fastmath.cpp checks them.
+// INFO: types other than float are processed element by element with the standard library.
+// INFO: GCC only vectorizes the float clamps and selects with -fno-trapping-math, which is clang's default.
+
+#ifndef FASTMATH_HPP
+#define FASTMATH_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <type_traits>
+
+#include "numa.hpp"
+
+#define MATH_THREADING_THRESHOLD 1'048'576 // INFO: threading is used only when count > MATH_THREADING_THRESHOLD
+#define MATH_TRIG_LIMIT 8192.0f // INFO: above this magnitude FAITHFUL sin/cos fall back to the standard library
+#define MATH_TRIG_CHUNK 256 // INFO: elements per chunk of fastSinCos, evaluated between stack buffers
+
+enum class MathAccuracy
+{
+        FAST,    // INFO: shorter polynomials and single-stage argument reduction
+        FAITHFUL // INFO: within a few ulp of the correctly rounded result
+};
+
+inline int32_t mathBits(float value)
+{
+        int32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+}
+
+inline float mathFloat(int32_t bits)
+{
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+}
+
+// INFO: FAITHFUL max 1 ulp, FAST max 2^-14 relative error; subnormal results keep only absolute accuracy
+template <MathAccuracy Accuracy>
+inline float expKernel(float x)
+{
+        // INFO: the clamp keeps the exponent representable, results still underflow and overflow naturally
+        float clamped = std::min(std::max(x, -104.0f), 89.0f);
+        float t = clamped*1.44269504089f + 12582912.0f; // INFO: adding 1.5*2^23 rounds to the nearest integer
+        float n = t - 12582912.0f;
+        int32_t exponent = mathBits(t) - mathBits(12582912.0f);
+        float r = clamped - n*0.693359375f - n*-2.12194440e-4f;
+        float p;
+        if constexpr (Accuracy == MathAccuracy::FAITHFUL)
+                p = (((((1.9875691500e-4f*r + 1.3981999507e-3f)*r + 8.3334519073e-3f)*r + 4.1665795894e-2f)*r + 1.6666665459e-1f)*r + 5.0000001201e-1f)*r*r + r + 1.0f;
+        else
+                p = ((4.1665795894e-2f*r + 1.6666665459e-1f)*r + 5.0000001201e-1f)*r*r + r + 1.0f;
+        // INFO: the scale is applied in two halves so that subnormal and overflowing results need no select
+        int32_t half = exponent >> 1;
+        return p*mathFloat((half + 127) << 23)*mathFloat((exponent - half + 127) << 23);
+}
+
+// INFO: FAITHFUL max 1 ulp, FAST max 2^-13 absolute error
+template <MathAccuracy Accuracy>
+inline float logKernel(float x)
+{
+        bool tiny = x < 1.17549435e-38f;
+        float scaled = tiny ? x*8388608.0f : x;
+        int32_t bits = mathBits(scaled);
+        int32_t exponent = ((bits >> 23) & 0xff) - 126 - (tiny ? 23 : 0);
+        float m = mathFloat((bits & 0x007fffff) | 0x3f000000); // INFO: mantissa in [0.5, 1)
+        bool low = m < 0.707106781186547524f;
+        exponent -= low ? 1 : 0;
+        float f = low ? m + m - 1.0f : m - 1.0f;
+        float e = static_cast<float>(exponent);
+        float z = f*f;
+        float p;
+        if constexpr (Accuracy == MathAccuracy::FAITHFUL)
+                p = ((((((((7.0376836292e-2f*f - 1.1514610310e-1f)*f + 1.1676998740e-1f)*f - 1.2420140846e-1f)*f + 1.4249322787e-1f)*f - 1.6668057665e-1f)*f + 2.0000714765e-1f)*f - 2.4999993993e-1f)*f + 3.3333331174e-1f);
+        else
+                p = (((1.4249322787e-1f*f - 1.6668057665e-1f)*f + 2.0000714765e-1f)*f - 2.4999993993e-1f)*f + 3.3333331174e-1f;
+        float y = p*f*z - 2.12194440e-4f*e - 0.5f*z;
+        float result = f + y + 0.693359375f*e;
+        result = (x == 0.0f) ? -std::numeric_limits<float>::infinity() : result;
+        result = (x < 0.0f) ? std::numeric_limits<float>::quiet_NaN() : result;
+        result = (x == std::numeric_limits<float>::infinity()) ? x : result;
+        result = (x != x) ? x : result;
+        return result;
+}
+
+// INFO: FAITHFUL max 1 ulp, FAST max 2^-16 absolute error
+template <MathAccuracy Accuracy>
+inline float tanhKernel(float x)
+{
+        float a = std::fabs(x);
+        float z = x*x;
+        float small = ((((-5.70498872745e-3f*z + 2.06390887954e-2f)*z - 5.37397155531e-2f)*z + 1.33314422036e-1f)*z - 3.33332819422e-1f)*z*x + x;
+        float large = 1.0f - 2.0f/(expKernel<Accuracy>(a + a) + 1.0f);
+        large = (x < 0.0f) ? -large : large;
+        return (a < 0.625f) ? small : large;
+}
+
+// INFO: FAITHFUL max 2 ulp, FAST max 2^-14 relative error
+template <MathAccuracy Accuracy>
+inline float sigmoidKernel(float x)
+{
+        return 1.0f/(1.0f + expKernel<Accuracy>(-x));
+}
+
+// INFO: FAITHFUL max 3 ulp, FAST max 2^-14 absolute error
+template <MathAccuracy Accuracy>
+inline float erfKernel(float x)
+{
+        float a = std::fabs(x);
+        float t = 1.0f/(1.0f + 0.5f*a);
+        float q = -a*a - 1.26551223f + t*(1.00002368f + t*(0.37409196f + t*(0.09678418f + t*(-0.18628806f + t*(0.27886807f + t*(-1.13520398f + t*(1.48851587f + t*(-0.82215223f + t*0.17087277f))))))));
+        float large = 1.0f - t*expKernel<Accuracy>(q);
+        large = (x < 0.0f) ? -large : large;
+        if constexpr (Accuracy == MathAccuracy::FAST)
+                return large;
+        // INFO: Maclaurin series of erf, accurate to float precision for |x| < 1
+        float z = x*x;
+        float small = x*(1.12837917f + z*(-0.376126389f + z*(0.112837917f + z*(-0.0268661706f + z*(0.00522397763f + z*(-8.54832702e-4f + z*(1.20553330e-4f + z*(-1.49256504e-5f + z*(1.64621144e-6f + z*(-1.63658447e-7f + z*1.48071928e-8f))))))))));
+        return (a < 1.0f) ? small : large;
+}
+
+// INFO: FAITHFUL max 1 ulp, FAST max 2^-17 relative error; inputs must be positive and normal
+template <MathAccuracy Accuracy>
+inline float rsqrtKernel(float x)
+{
+        float y = mathFloat(0x5f3759df - (mathBits(x) >> 1));
+        y = y*(1.5f - 0.5f*x*y*y);
+        y = y*(1.5f - 0.5f*x*y*y);
+        if constexpr (Accuracy == MathAccuracy::FAST)
+                return y;
+        double yd = y;
+        return static_cast<float>(yd*(1.5 - 0.5*static_cast<double>(x)*yd*yd));
+}
+
+// INFO: FAITHFUL max 2 ulp for |x| <= 4 and 2^-23 absolute error below MATH_TRIG_LIMIT (libm above it),
+// INFO: FAST max 2^-23 absolute error for |x| < 1024
+template <MathAccuracy Accuracy>
+inline void sinCosKernel(float x, float &sine, float &cosine)
+{
+        float a = std::fabs(x);
+        // INFO: the octant is taken from a clamped copy so the conversion stays defined for huge, infinite and NaN
+        // INFO: inputs, whose results are meaningless here and which FAITHFUL recomputes with the standard library
+        int32_t j = static_cast<int32_t>(std::min(MATH_TRIG_LIMIT, a)*1.27323954473516f);
+        j = (j + 1) & ~1;
+        float y = static_cast<float>(j);
+        float r;
+        if constexpr (Accuracy == MathAccuracy::FAITHFUL)
+                r = ((a - y*0.78515625f) - y*2.4187564849853515625e-4f) - y*3.77489497744594108e-8f;
+        else
+                r = (a - y*0.78515625f) - y*2.41913397e-4f;
+        float z = r*r;
+        float s = ((-1.9515295891e-4f*z + 8.3321608736e-3f)*z - 1.6666654611e-1f)*z*r + r;
+        float c = ((2.443315711809948e-5f*z - 1.388731625493765e-3f)*z + 4.166664568298827e-2f)*z*z - 0.5f*z + 1.0f;
+        bool swap = (j & 2) != 0;
+        float sineResult = swap ? c : s;
+        float cosineResult = swap ? s : c;
+        // INFO: two separate selects, a single select on the xor of both masks keeps GCC from vectorizing
+        sineResult = ((j & 4) != 0) ? -sineResult : sineResult;
+        sineResult = (x < 0.0f) ? -sineResult : sineResult;
+        cosineResult = (((j + 2) & 4) != 0) ? -cosineResult : cosineResult;
+        sine = sineResult;
+        cosine = cosineResult;
+}
+
+template <typename Function>
+void mathForEach(uint64_t count, const Function &function)
+{
+        uint32_t numThreads = numaThreadCount();
+        if (count <= MATH_THREADING_THRESHOLD || numThreads < 2)
+        {
+                function(0, count);
+                return;
+        }
+        numaForEachPartition(numaPartition(count, numThreads), [&function](const NumaPartition &partition)
+        {
+                function(partition.start, partition.end);
+        });
+}
+
+template <typename T, typename Kernel, typename Fallback>
+void mathApply(const T *input, T *output, uint64_t count, const Kernel &kernel, const Fallback &fallback)
+{
+        mathForEach(count, [&](uint64_t start, uint64_t end)
+        {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = kernel(input[i]);
+                }
+                else
+                {
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = static_cast<T>(fallback(input[i]));
+                }
+        });
+}
+
+template <typename T>
+void fastExp(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return std::exp(x); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, expKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, expKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+template <typename T>
+void fastLog(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return std::log(x); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, logKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, logKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+template <typename T>
+void fastTanh(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return std::tanh(x); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, tanhKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, tanhKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+template <typename T>
+void fastSigmoid(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return T(1)/(T(1) + std::exp(-x)); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, sigmoidKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, sigmoidKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+template <typename T>
+void fastErf(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return std::erf(x); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, erfKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, erfKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+template <typename T>
+void fastRsqrt(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        auto fallback = [](const T &x) { return T(1)/std::sqrt(x); };
+        if (accuracy == MathAccuracy::FAST)
+                mathApply(input, output, count, rsqrtKernel<MathAccuracy::FAST>, fallback);
+        else
+                mathApply(input, output, count, rsqrtKernel<MathAccuracy::FAITHFUL>, fallback);
+}
+
+// INFO: sines or cosines may be nullptr when only one of them is needed, either may alias input
+template <typename T>
+void fastSinCos(const T *input, T *sines, T *cosines, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        mathForEach(count, [&](uint64_t start, uint64_t end)
+        {
+                // INFO: each chunk is evaluated between local buffers, so the kernel loops carry no branches and the
+                // INFO: FAITHFUL fallback still sees the arguments when the call overwrites its input
+                T arguments[MATH_TRIG_CHUNK];
+                T sineChunk[MATH_TRIG_CHUNK];
+                T cosineChunk[MATH_TRIG_CHUNK];
+                for (uint64_t chunk = start; chunk < end; chunk += MATH_TRIG_CHUNK)
+                {
+                        uint64_t size = std::min<uint64_t>(MATH_TRIG_CHUNK, end - chunk);
+                        std::copy(input + chunk, input + chunk + size, arguments);
+                        if constexpr (std::is_same<T, float>::value)
+                        {
+                                if (accuracy == MathAccuracy::FAST)
+                                {
+                                        for (uint64_t i = 0; i < size; i++)
+                                                sinCosKernel<MathAccuracy::FAST>(arguments[i], sineChunk[i], cosineChunk[i]);
+                                }
+                                else
+                                {
+                                        for (uint64_t i = 0; i < size; i++)
+                                                sinCosKernel<MathAccuracy::FAITHFUL>(arguments[i], sineChunk[i], cosineChunk[i]);
+                                        // INFO: the three-part reduction loses precision above MATH_TRIG_LIMIT, those rare inputs are redone by libm
+                                        for (uint64_t i = 0; i < size; i++)
+                                        {
+                                                if (!(std::fabs(arguments[i]) < MATH_TRIG_LIMIT))
+                                                {
+                                                        sineChunk[i] = std::sin(arguments[i]);
+                                                        cosineChunk[i] = std::cos(arguments[i]);
+                                                }
+                                        }
+                                }
+                        }
+                        else
+                        {
+                                for (uint64_t i = 0; i < size; i++)
+                                {
+                                        sineChunk[i] = std::sin(arguments[i]);
+                                        cosineChunk[i] = std::cos(arguments[i]);
+                                }
+                        }
+                        if (sines != nullptr)
+                                std::copy(sineChunk, sineChunk + size, sines + chunk);
+                        if (cosines != nullptr)
+                                std::copy(cosineChunk, cosineChunk + size, cosines + chunk);
+                }
+        });
+}
+
+template <typename T>
+void fastSin(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastSinCos<T>(input, output, nullptr, count, accuracy);
+}
+
+template <typename T>
+void fastCos(const T *input, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastSinCos<T>(input, nullptr, output, count, accuracy);
+}
+
+// INFO: FAST evaluates exp(exponent*log(base)) with the float kernels, its relative error is the 2^-14 of the
+// INFO: FAST exp kernel plus at most 2^-22*|exponent*log(base)| from rounding the product; FAITHFUL goes
+// INFO: through double and is within 1 ulp; negative bases are only defined in FAITHFUL mode
+template <typename T>
+void fastPow(const T *base, const T *exponent, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        mathForEach(count, [&](uint64_t start, uint64_t end)
+        {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                        if (accuracy == MathAccuracy::FAST)
+                        {
+                                for (uint64_t i = start; i < end; i++)
+                                        output[i] = expKernel<MathAccuracy::FAST>(exponent[i]*logKernel<MathAccuracy::FAITHFUL>(base[i]));
+                                return;
+                        }
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = static_cast<float>(std::pow(static_cast<double>(base[i]), static_cast<double>(exponent[i])));
+                }
+                else
+                {
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = static_cast<T>(std::pow(base[i], exponent[i]));
+                }
+        });
+}
+
+template <typename T>
+void fastPow(const T *base, const T &exponent, T *output, uint64_t count, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        mathForEach(count, [&](uint64_t start, uint64_t end)
+        {
+                if constexpr (std::is_same<T, float>::value)
+                {
+                        if (accuracy == MathAccuracy::FAST)
+                        {
+                                for (uint64_t i = start; i < end; i++)
+                                        output[i] = expKernel<MathAccuracy::FAST>(exponent*logKernel<MathAccuracy::FAITHFUL>(base[i]));
+                                return;
+                        }
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = static_cast<float>(std::pow(static_cast<double>(base[i]), static_cast<double>(exponent)));
+                }
+                else
+                {
+                        for (uint64_t i = start; i < end; i++)
+                                output[i] = static_cast<T>(std::pow(base[i], exponent));
+                }
+        });
+}
+
+// INFO: in-place overloads for any storage exposing data() and size(), e.g. HeapArray, Tensor or one SoA component
+template <typename Storage>
+Storage &fastExp(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastExp(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastLog(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastLog(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastTanh(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastTanh(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastSigmoid(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastSigmoid(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastErf(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastErf(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastRsqrt(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastRsqrt(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastSin(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastSin(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+template <typename Storage>
+Storage &fastCos(Storage &values, MathAccuracy accuracy = MathAccuracy::FAITHFUL)
+{
+        fastCos(values.data(), values.data(), values.size(), accuracy);
+        return values;
+}
+
+// INFO: distance between two floats in units in the last place, NaN matches only NaN
+inline uint64_t ulpDistance(float a, float b)
+{
+        if (a != a || b != b)
+                return (a != a && b != b) ? 0 : std::numeric_limits<uint64_t>::max();
+        if (a == b)
+                return 0;
+        int64_t ia = mathBits(a);
+        int64_t ib = mathBits(b);
+        ia = (ia < 0) ? int64_t(INT32_MIN) - ia : ia;
+        ib = (ib < 0) ? int64_t(INT32_MIN) - ib : ib;
+        return (ia > ib) ? ia - ib : ib - ia;
+}
+
+#endif // FASTMATH_HPP
@@ -5,48 +5,176 @@
 #include <cstdint>
 #include <array>
 #include <memory>
+#include <atomic>
 #include <stdexcept>
+#include <vector>
+#include <algorithm>
+
+#include "numa.hpp"
+#include "reduction.hpp"
+#include "random.hpp"
+
+template <typename T, uint64_t N>
+struct HeapArrayDeleter
+{
+        bool numa = false;
+
+        void operator()(std::array<T, N> *pointer) const
+        {
+                if (!numa)
+                {
+                        delete pointer;
+                        return;
+                }
+                pointer->~array();
+                numaFree(pointer, sizeof(std::array<T, N>));
+        }
+};
 
 template <typename T, uint64_t N>
 class HeapArray
 {
 private:
-        std::unique_ptr<std::array<T, N>> mArray;
+        std::shared_ptr<std::array<T, N>> mArray; // INFO: shared between copies until one of them writes
+        NumaPolicy mPolicy = NumaPolicy::DEFAULT;
+        uint64_t mGrain = 1; // INFO: elements per row, blocks are placed on row boundaries
+        bool mCopyOnWrite = true;
+
+        void allocate()
+        {
+                if (mPolicy == NumaPolicy::DEFAULT)
+                {
+                        mArray = std::shared_ptr<std::array<T, N>>(new std::array<T, N>, HeapArrayDeleter<T, N>{});
+                        return;
+                }
+                void *memory = numaAllocate(sizeof(std::array<T, N>));
+                mArray = std::shared_ptr<std::array<T, N>>(new (memory) std::array<T, N>, HeapArrayDeleter<T, N>{true});
+                if (mPolicy == NumaPolicy::INTERLEAVE)
+                {
+                        numaInterleave(memory, sizeof(std::array<T, N>));
+                        return;
+                }
+                for (const NumaPartition &partition : partitions())
+                        numaPlace(mArray->data() + partition.start, (partition.end - partition.start)*sizeof(T), partition.node);
+        }
+
+        // INFO: element ranges matching the row partition used by dispatchThreads
+        std::vector<NumaPartition> partitions() const
+        {
+                std::vector<NumaPartition> result = numaPartition(N / mGrain, numaThreadCount());
+                for (NumaPartition &partition : result)
+                {
+                        partition.start *= mGrain;
+                        partition.end *= mGrain;
+                }
+                result.back().end = N;
+                return result;
+        }
+
+        // INFO: under BLOCKED placement each block is first touched by a worker pinned to its node
+        void placeFill(const T &value)
+        {
+                if (mPolicy != NumaPolicy::BLOCKED)
+                {
+                        mArray->fill(value);
+                        return;
+                }
+                T *data = mArray->data();
+                numaForEachPartition(partitions(), [data, &value](const NumaPartition &partition)
+                {
+                        std::fill(data + partition.start, data + partition.end, value);
+                });
+        }
+
+        // INFO: buffer for a write that covers every element, a shared buffer is replaced instead of copied
+        T *overwrite()
+        {
+                if (!isUnique())
+                        allocate();
+                return mArray->data();
+        }
+
+        void placeCopy(const T *source)
+        {
+                if (mPolicy != NumaPolicy::BLOCKED)
+                {
+                        std::copy(source, source + N, mArray->data());
+                        return;
+                }
+                T *data = mArray->data();
+                numaForEachPartition(partitions(), [data, source](const NumaPartition &partition)
+                {
+                        std::copy(source + partition.start, source + partition.end, data + partition.start);
+                });
+        }
 
 public:
-        HeapArray() : mArray(std::make_unique<std::array<T, N>>())
+        HeapArray()
         {
+                allocate();
                 mArray->fill(0);
         };
 
-        HeapArray(const T &value) : mArray(std::make_unique<std::array<T, N>>())
+        HeapArray(const T &value)
         {
+                allocate();
                 mArray->fill(value);
 
         }
 
-        HeapArray(const std::array<T, N> &array) : mArray(std::make_unique<std::array<T, N>>())
+        HeapArray(const std::array<T, N> &array)
         {
+                allocate();
                 *mArray = array;
         }
 
-        HeapArray(const HeapArray<T, N> &array) : mArray(std::make_unique<std::array<T, N>>())
+        HeapArray(NumaPolicy policy, uint64_t grain = 1) : mPolicy(policy), mGrain((grain == 0 || grain > N) ? 1 : grain)
+        {
+                allocate();
+                placeFill(0);
+        }
+
+        HeapArray(const T &value, NumaPolicy policy, uint64_t grain = 1) : mPolicy(policy), mGrain((grain == 0 || grain > N) ? 1 : grain)
         {
-                *mArray = *array.mArray;
+                allocate();
+                placeFill(value);
+        }
+
+        // INFO: copies share the buffer in O(1), a deep copy happens only when either side writes
+        HeapArray(const HeapArray<T, N> &array) : mPolicy(array.mPolicy), mGrain(array.mGrain), mCopyOnWrite(array.mCopyOnWrite)
+        {
+                if (mCopyOnWrite)
+                {
+                        mArray = array.mArray;
+                        return;
+                }
+                allocate();
+                placeCopy(array.mArray->data());
         }
 
         ~HeapArray() = default;
 
         HeapArray<T, N> &operator=(const HeapArray<T, N> &array)
         {
-                *mArray = *array.mArray;
+                if (this == &array)
+                        return *this;
+                if (mCopyOnWrite && array.mCopyOnWrite)
+                {
+                        mArray = array.mArray;
+                        return *this;
+                }
+                if (!isUnique())
+                        allocate();
+                placeCopy(array.mArray->data());
                 return *this;
         }
 
+        // INFO: references returned here stay valid only until the array is copied again
         T &operator[](uint64_t index)
         {
                 if (index >= N)
                         throw std::out_of_range("Index out of range.");
+                detach();
                 return (*mArray)[index];
         }
 
@@ -59,12 +187,78 @@ public:
 
         void fill(const T &value)
         {
-                mArray->fill(value);
+                if (isUnique())
+                {
+                        mArray->fill(value);
+                        return;
+                }
+                allocate();
+                placeFill(value);
         }
 
         void zero()
         {
-                mArray->fill(0);
+                fill(0);
+        }
+
+        void fillUniform(Philox &generator, const T &low = 0, const T &high = 1)
+        {
+                generator.uniform(overwrite(), N, low, high);
+        }
+
+        void fillNormal(Philox &generator, const T &mean = 0, const T &stddev = 1)
+        {
+                generator.normal(overwrite(), N, mean, stddev);
+        }
+
+        void fillTruncatedNormal(Philox &generator, const T &mean = 0, const T &stddev = 1, const T &bound = RANDOM_TRUNCATION)
+        {
+                generator.truncatedNormal(overwrite(), N, mean, stddev, bound);
+        }
+
+        // INFO: makes this array the sole owner of its buffer, copying it if it is shared
+        void detach()
+        {
+                if (!mCopyOnWrite || isUnique())
+                        return;
+                std::shared_ptr<std::array<T, N>> shared = mArray;
+                allocate();
+                placeCopy(shared->data());
+        }
+
+        // INFO: use_count() is a relaxed load, the acquire fence orders every access made through the
+        // INFO: last released copy before the writes that follow a positive answer
+        bool isUnique() const
+        {
+                if (mArray.use_count() != 1)
+                        return false;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return true;
+        }
+
+        // INFO: disabling copy-on-write detaches now and makes every later copy from this array deep,
+        // INFO: which removes the reference count check from hot mutable buffers
+        void copyOnWrite(bool enabled)
+        {
+                if (!enabled)
+                        detach();
+                mCopyOnWrite = enabled;
+        }
+
+        bool copyOnWrite() const
+        {
+                return mCopyOnWrite;
+        }
+
+        const T *data() const
+        {
+                return mArray->data();
+        }
+
+        T *data()
+        {
+                detach();
+                return mArray->data();
         }
 
         void print() const
@@ -79,20 +273,56 @@ public:
                 return N;
         }
 
-        T sum() const
+        NumaPolicy policy() const
         {
-                uint64_t sum = 0;
-                for (uint64_t i = 0; i < N; i++)
-                        sum += (*mArray)[i];
-                return sum;
+                return mPolicy;
         }
 
-        T mul() const
+        uint64_t grain() const
         {
-                uint64_t mul = 1;
-                for (uint64_t i = 0; i < N; i++)
-                        mul *= (*mArray)[i];
-                return mul;
+                return mGrain;
+        }
+
+        // INFO: accumulates and returns Accumulator<T> (e.g. double for float, int64_t for int32_t),
+        // INFO: so wide sums of narrow types neither lose precision nor wrap on return
+        Accumulator<T> sum(SummationMode mode = SummationMode::PAIRWISE) const
+        {
+                return reduceSum(mArray->data(), N, mode);
+        }
+
+        Accumulator<T> mul() const
+        {
+                return reduceProduct(mArray->data(), N);
+        }
+
+        Accumulator<T> dot(const HeapArray<T, N> &array, SummationMode mode = SummationMode::PAIRWISE) const
+        {
+                return reduceDot(mArray->data(), array.mArray->data(), N, mode);
+        }
+
+        NormAccumulator<T> norm(SummationMode mode = SummationMode::PAIRWISE) const
+        {
+                return reduceNorm2(mArray->data(), N, mode);
+        }
+
+        T min() const
+        {
+                return reduceMin(mArray->data(), N).value;
+        }
+
+        T max() const
+        {
+                return reduceMax(mArray->data(), N).value;
+        }
+
+        uint64_t argmin() const
+        {
+                return reduceMin(mArray->data(), N).index;
+        }
+
+        uint64_t argmax() const
+        {
+                return reduceMax(mArray->data(), N).index;
         }
 };
 
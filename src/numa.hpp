@@ -0,0 +1,246 @@
+// INFO: NUMA topology, page placement and thread pinning helpers.
+// INFO: on non-Linux systems everything degrades to a single node and the helpers become no-ops.
+
+#ifndef NUMA_HPP
+#define NUMA_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <new>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+// INFO: memory policy values of the Linux mbind syscall (see <numaif.h>), defined here to avoid a libnuma dependency
+#define NUMA_MPOL_PREFERRED 1
+#define NUMA_MPOL_INTERLEAVE 3
+#define NUMA_MAX_NODES 64
+
+enum class NumaPolicy
+{
+        DEFAULT,    // INFO: plain heap allocation, pages land wherever the constructor runs
+        INTERLEAVE, // INFO: pages are interleaved round-robin across all nodes
+        BLOCKED     // INFO: each row block is placed on the node of the worker that processes it
+};
+
+struct NumaTopology
+{
+        std::vector<uint32_t> nodeIds; // INFO: kernel node ids, sparse when some nodes are offline
+        std::vector<std::vector<uint32_t>> nodeCpus; // INFO: indexed like nodeIds
+};
+
+struct NumaPartition
+{
+        uint64_t start;
+        uint64_t end;
+        uint32_t node; // INFO: index into NumaTopology, not the kernel node id
+};
+
+inline std::vector<uint32_t> parseCpuList(const std::string &list)
+{
+        std::vector<uint32_t> cpus;
+        uint64_t pos = 0;
+        while (pos < list.size())
+        {
+                uint64_t next = list.find(',', pos);
+                if (next == std::string::npos)
+                        next = list.size();
+                std::string range = list.substr(pos, next - pos);
+                uint64_t dash = range.find('-');
+                if (!range.empty() && range[0] >= '0' && range[0] <= '9')
+                {
+                        uint32_t first = std::stoul(range.substr(0, dash));
+                        uint32_t last = (dash == std::string::npos) ? first : std::stoul(range.substr(dash + 1));
+                        for (uint32_t cpu = first; cpu <= last; cpu++)
+                                cpus.push_back(cpu);
+                }
+                pos = next + 1;
+        }
+        return cpus;
+}
+
+inline const NumaTopology &numaTopology()
+{
+        static const NumaTopology topology = []()
+        {
+                NumaTopology result;
+#ifdef __linux__
+                std::ifstream online("/sys/devices/system/node/online");
+                std::string nodes;
+                if (online.is_open())
+                        std::getline(online, nodes);
+                for (uint32_t node : parseCpuList(nodes))
+                {
+                        // INFO: node masks passed to mbind are 64 bits wide
+                        if (node >= NUMA_MAX_NODES)
+                                break;
+                        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                        std::string list;
+                        if (file.is_open())
+                                std::getline(file, list);
+                        result.nodeIds.push_back(node);
+                        result.nodeCpus.push_back(parseCpuList(list));
+                }
+#endif
+                if (result.nodeCpus.empty())
+                {
+                        result.nodeIds.push_back(0);
+                        result.nodeCpus.emplace_back();
+                }
+                return result;
+        }();
+        return topology;
+}
+
+inline uint32_t numaNodeCount()
+{
+        return numaTopology().nodeCpus.size();
+}
+
+inline uint64_t numaPageSize()
+{
+#ifdef __linux__
+        return sysconf(_SC_PAGESIZE);
+#else
+        return 4096;
+#endif
+}
+
+// INFO: threads are assigned to nodes in contiguous groups so that thread i always owns the i-th row range on the same node,
+// INFO: the first count % numThreads partitions take one extra row so that no thread gets more than one row above the rest
+inline std::vector<NumaPartition> numaPartition(uint64_t count, uint32_t numThreads)
+{
+        if (numThreads == 0)
+                numThreads = 1;
+        std::vector<NumaPartition> partitions;
+        partitions.reserve(numThreads);
+        uint32_t nodes = numaNodeCount();
+        uint64_t chunkSize = count / numThreads;
+        uint64_t remainder = count % numThreads;
+        uint64_t start = 0;
+        for (uint32_t i = 0; i < numThreads; i++)
+        {
+                uint64_t end = start + chunkSize + ((i < remainder) ? 1 : 0);
+                partitions.push_back({start, end, static_cast<uint32_t>(uint64_t(i)*nodes/numThreads)});
+                start = end;
+        }
+        return partitions;
+}
+
+inline bool numaPinThread(uint32_t node)
+{
+#ifdef __linux__
+        const NumaTopology &topology = numaTopology();
+        if (topology.nodeCpus.size() < 2 || node >= topology.nodeCpus.size() || topology.nodeCpus[node].empty())
+                return false;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (uint32_t cpu : topology.nodeCpus[node])
+                CPU_SET(cpu, &set);
+        return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+        (void)node;
+        return false;
+#endif
+}
+
+// INFO: returns false when the kernel has no NUMA support, in which case first-touch placement still applies
+inline bool numaBind(void *address, uint64_t bytes, int mode, uint64_t nodeMask)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+        uint64_t pageSize = numaPageSize();
+        uintptr_t start = reinterpret_cast<uintptr_t>(address) & ~(pageSize - 1);
+        uint64_t length = reinterpret_cast<uintptr_t>(address) + bytes - start;
+        unsigned long mask = nodeMask;
+        return syscall(SYS_mbind, start, length, mode, &mask, sizeof(mask)*8 + 1, 0) == 0;
+#else
+        (void)address; (void)bytes; (void)mode; (void)nodeMask;
+        return false;
+#endif
+}
+
+inline bool numaInterleave(void *address, uint64_t bytes)
+{
+        const NumaTopology &topology = numaTopology();
+        if (topology.nodeIds.size() < 2)
+                return false;
+        uint64_t mask = 0;
+        for (uint32_t node : topology.nodeIds)
+                mask |= uint64_t(1) << node;
+        return numaBind(address, bytes, NUMA_MPOL_INTERLEAVE, mask);
+}
+
+inline bool numaPlace(void *address, uint64_t bytes, uint32_t node)
+{
+        const NumaTopology &topology = numaTopology();
+        if (topology.nodeIds.size() < 2 || node >= topology.nodeIds.size())
+                return false;
+        return numaBind(address, bytes, NUMA_MPOL_PREFERRED, uint64_t(1) << topology.nodeIds[node]);
+}
+
+// INFO: page-aligned allocation whose pages are not touched until the caller writes them
+inline void *numaAllocate(uint64_t bytes)
+{
+#ifdef __linux__
+        void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (address == MAP_FAILED)
+                throw std::bad_alloc();
+        return address;
+#else
+        void *address = std::aligned_alloc(numaPageSize(), (bytes + numaPageSize() - 1) / numaPageSize() * numaPageSize());
+        if (address == nullptr)
+                throw std::bad_alloc();
+        return address;
+#endif
+}
+
+inline void numaFree(void *address, uint64_t bytes)
+{
+#ifdef __linux__
+        munmap(address, bytes);
+#else
+        (void)bytes;
+        std::free(address);
+#endif
+}
+
+inline uint32_t numaThreadCount()
+{
+        uint32_t count = std::thread::hardware_concurrency();
+        return (count == 0) ? 1 : count;
+}
+
+// INFO: runs function(partition) on one pinned thread per partition, used for first-touch and NUMA-local work
+template <typename Function>
+void numaForEachPartition(const std::vector<NumaPartition> &partitions, Function function)
+{
+        if (partitions.size() < 2)
+        {
+                for (const NumaPartition &partition : partitions)
+                        function(partition);
+                return;
+        }
+        std::vector<std::thread> threads;
+        threads.reserve(partitions.size());
+        for (const NumaPartition &partition : partitions)
+        {
+                threads.emplace_back([&function, partition]()
+                {
+                        numaPinThread(partition.node);
+                        function(partition);
+                });
+        }
+        for (std::thread &thread : threads)
+                thread.join();
+}
+
+#endif // NUMA_HPP
@@ -14,9 +14,16 @@
 #include <array>
 #include <memory>
 #include <type_traits>
+#include <algorithm>
 
 #include "heaparray.hpp"
-#include "tensor.hpp"
+#include "numa.hpp"
+#include "transpose.hpp"
+#include "tensor_cpu.hpp"
+
+#ifdef __unix__
+#include "distributed.hpp"
+#endif
 
 #define THREADING_THRESHOLD 500 // INFO: threading is used only when R > THREADING_THRESHOLD
 #define BIG_MATRIX_SIZE 1'000'000'000 // INFO: matrix size at which big matrix algorithms are used
@@ -24,61 +31,27 @@
 template <typename T, uint64_t R, uint64_t C, typename Enable = void>
 class Matrix;
 
-template <typename T, uint64_t R, uint64_t C>
-using ThreadFunction = void(*)(Matrix<T, R, C> &, const Matrix<T, R, C> &, const Matrix<T, R, C> &, uint64_t, uint64_t);
+template <typename T, uint64_t R, uint64_t C, uint64_t C2 = C>
+using ThreadFunction = void(*)(Matrix<T, R, C2> &, const Matrix<T, R, C> &, const Matrix<T, C, C2> &, uint64_t, uint64_t);
 
 // TODO: move dispatchThreads to a specific functions and rename e.g. dispatchThreadsMultiply
 
-template <typename T,  uint64_t R, uint64_t C>
-void dispatchThreads(Matrix<T, R, C> &result,
-                     const Matrix<T, R, C> &matrix1,
-                     const Matrix<T, R, C> &matrix2,
-                     ThreadFunction<T, R, C> threadFunction)
-{
-        if (R < std::thread::hardware_concurrency() * 100)
-        {
-                threadFunction(result, matrix1, matrix2, 0, R);
-                return;
-        }
-        std::vector<std::thread> threads;
-        uint8_t numThreads = std::thread::hardware_concurrency();
-        threads.reserve(numThreads);
-        uint64_t chunkSize = R / numThreads;
-        for (uint8_t i = 0; i < numThreads; i++)
-        {
-                if (i == numThreads - 1)
-                        threads.emplace_back(threadFunction, std::ref(result), std::ref(matrix1), std::ref(matrix2), i*chunkSize, R);
-                else
-                        threads.emplace_back(threadFunction, std::ref(result), std::ref(matrix1), std::ref(matrix2), i*chunkSize, (i + 1)*chunkSize);
-        }
-        for (uint8_t i = 0; i < numThreads; i++)
-                threads[i].join();
-}
-
 template <typename T, uint64_t R, uint64_t C, uint64_t C2>
-void dispatchThreads(Matrix<T, R, C> &result,
+void dispatchThreads(Matrix<T, R, C2> &result,
                      const Matrix<T, R, C> &matrix1,
                      const Matrix<T, C, C2> &matrix2,
-                     ThreadFunction<T, R, C> threadFunction)
+                     ThreadFunction<T, R, C, C2> threadFunction)
 {
         if (R < THREADING_THRESHOLD)
         {
                 threadFunction(result, matrix1, matrix2, 0, R);
                 return;
         }
-        std::vector<std::thread> threads;
-        uint8_t numThreads = std::thread::hardware_concurrency();
-        threads.reserve(numThreads);
-        uint64_t chunkSize = R / numThreads;
-        for (uint8_t i = 0; i < numThreads; i++)
+        // INFO: same partition as HeapArray BLOCKED placement, so every thread works on rows local to its node
+        numaForEachPartition(numaPartition(R, numaThreadCount()), [&](const NumaPartition &partition)
         {
-                if (i == numThreads - 1)
-                        threads.emplace_back(threadFunction, std::ref(result), std::ref(matrix1), std::ref(matrix2), i*chunkSize, R);
-                else
-                        threads.emplace_back(threadFunction, std::ref(result), std::ref(matrix1), std::ref(matrix2), i*chunkSize, (i + 1)*chunkSize);
-        }
-        for (uint8_t i = 0; i < numThreads; i++)
-                threads[i].join();
+                threadFunction(result, matrix1, matrix2, partition.start, partition.end);
+        });
 }
 
 // INFO: add thread is used only when R*C > THREADING_THRESHOLD
@@ -95,32 +68,39 @@ void subtractThread()
 
 }
 
-template <typename T, uint64_t R, uint64_t C>
-void multiplyThread(Matrix<T, R, C> &result, const Matrix<T, R, C> &matrix1, const Matrix<T, R, C> &matrix2, uint64_t start, uint64_t end)
+// INFO: operands are read through their layout strides, so transposed views are multiplied without a copy
+template <typename T, uint64_t R, uint64_t C, uint64_t C2>
+void multiplyThread(Matrix<T, R, C2> &result, const Matrix<T, R, C> &matrix1, const Matrix<T, C, C2> &matrix2, uint64_t start, uint64_t end)
 {
-        for (uint64_t i = start; i < end; i++)
-        {
-                for (uint64_t j = 0; j < C; j++)
+        const T *a = matrix1.data();
+        const T *b = matrix2.data();
+        T *c = result.data();
+        uint64_t aRowStride = matrix1.rowStride();
+        uint64_t aColStride = matrix1.colStride();
+        uint64_t cRowStride = result.rowStride();
+        uint64_t cColStride = result.colStride();
+        if (matrix2.layout() == Layout::COLUMN_MAJOR)
+        {
+                // INFO: transposed-operand path, every column of matrix2 is contiguous so each entry is a contiguous dot product
+                for (uint64_t i = start; i < end; i++)
                 {
-                        for (uint64_t k = 0; k < R; k++)
+                        for (uint64_t j = 0; j < C2; j++)
                         {
-                                result(i, j) += matrix1(i, k) * matrix2(k, j);
+                                T sum = 0;
+                                for (uint64_t k = 0; k < C; k++)
+                                        sum += a[i*aRowStride + k*aColStride] * b[j*C + k];
+                                c[i*cRowStride + j*cColStride] += sum;
                         }
                 }
+                return;
         }
-}
-
-template <typename T, uint64_t R, uint64_t C, uint64_t C2>
-void multiplyThread(Matrix<T, R, C> &result, const Matrix<T, R, C> &matrix1, const Matrix<T, C, C2> &matrix2, uint64_t start, uint64_t end)
-{
         for (uint64_t i = start; i < end; i++)
         {
-                for (uint64_t j = 0; j < C2; j++)
+                for (uint64_t k = 0; k < C; k++)
                 {
-                        for (uint64_t k = 0; k < C; k++)
-                        {
-                                result(i, j) += matrix1(i, k) * matrix2(k, j);
-                        }
+                        T value = a[i*aRowStride + k*aColStride];
+                        for (uint64_t j = 0; j < C2; j++)
+                                c[i*cRowStride + j*cColStride] += value * b[k*C2 + j];
                 }
         }
 }
@@ -150,72 +130,129 @@ class Matrix<T, R, C, typename std::enable_if<!(R > BIG_MATRIX_SIZE || C > BIG_M
 {
 private:
         HeapArray<T, R*C> mMatrix;
+        Layout mLayout = Layout::ROW_MAJOR;
+
+        template <typename, uint64_t, uint64_t, typename>
+        friend class Matrix;
+
+        uint64_t index(uint64_t row, uint64_t col) const
+        {
+                return (mLayout == Layout::ROW_MAJOR) ? row*C + col : col*R + row;
+        }
+
+        // INFO: storage of matrix in the layout of this matrix, shared without a copy when the layouts already match
+        HeapArray<T, R*C> sameLayout(const Matrix<T, R, C> &matrix) const
+        {
+                if (matrix.mLayout == mLayout)
+                        return matrix.mMatrix;
+                return matrix.toLayout(mLayout).mMatrix;
+        }
+
+        // INFO: zeroed storage with the NUMA policy of this matrix, one grain per row or column of the given layout,
+        // INFO: so the rows of a result are placed on the same nodes as the rows of this matrix that produce them
+        template <uint64_t R2, uint64_t C2>
+        HeapArray<T, R2*C2> resultStorage(Layout layout) const
+        {
+                return HeapArray<T, R2*C2>(mMatrix.policy(), (layout == Layout::ROW_MAJOR) ? C2 : R2);
+        }
 
 public:
         Matrix() : mMatrix(HeapArray<T, R*C>()) {}
         Matrix(const T &value) : mMatrix(HeapArray<T, R*C>(value)) {}
         Matrix(const HeapArray<T, R*C> &matrix) : mMatrix(matrix) {}
-        Matrix(const Matrix<T, R, C> &matrix) : mMatrix(matrix.mMatrix) {}
+        Matrix(const HeapArray<T, R*C> &matrix, Layout layout) : mMatrix(matrix), mLayout(layout) {}
+        Matrix(const Matrix<T, R, C> &matrix) : mMatrix(matrix.mMatrix), mLayout(matrix.mLayout) {}
+        Matrix(NumaPolicy policy) : mMatrix(HeapArray<T, R*C>(policy, C)) {}
+        Matrix(const T &value, NumaPolicy policy) : mMatrix(HeapArray<T, R*C>(value, policy, C)) {}
 
         Matrix<T, R, C> operator+(const Matrix<T, R, C> &matrix) const
         {
-                Matrix<T, R, C> result;
+                Matrix<T, R, C> result(resultStorage<R, C>(mLayout), mLayout);
+                const HeapArray<T, R*C> other = sameLayout(matrix);
+                const T *left = mMatrix.data();
+                const T *right = other.data();
+                T *output = result.mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        result.mMatrix[i] = mMatrix[i] + matrix.mMatrix[i];
+                        output[i] = left[i] + right[i];
                 return result;
         }
 
         Matrix<T, R, C> operator-(const Matrix<T, R, C> &matrix) const
         {
-                Matrix<T, R, C> result;
+                Matrix<T, R, C> result(resultStorage<R, C>(mLayout), mLayout);
+                const HeapArray<T, R*C> other = sameLayout(matrix);
+                const T *left = mMatrix.data();
+                const T *right = other.data();
+                T *output = result.mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        result.mMatrix[i] = mMatrix[i] - matrix.mMatrix[i];
+                        output[i] = left[i] - right[i];
                 return result;
         }
 
         Matrix<T, R, C> operator*(const Matrix<T, R, C> &matrix) const
         {
-                Matrix<T, R, C> result;
-                ThreadFunction<T, R, C> function = reinterpret_cast<ThreadFunction<T, R, C>>(multiplyThread<T, R, C>);
-                dispatchThreads<T, R, C>(result, *this, matrix, function);
+                Matrix<T, R, C> result(resultStorage<R, C>(Layout::ROW_MAJOR), Layout::ROW_MAJOR);
+                dispatchThreads<T, R, C, C>(result, *this, matrix, multiplyThread<T, R, C, C>);
                 return result;
         }
 
         template <uint64_t C2>
         Matrix<T, R, C2> operator*(const Matrix<T, C, C2> &matrix) const
         {
-                Matrix<T, R, C2> result;
-                // TODO: implement matrix multiplication for matrices with different sizes
+                Matrix<T, R, C2> result(resultStorage<R, C2>(Layout::ROW_MAJOR), Layout::ROW_MAJOR);
+                dispatchThreads<T, R, C, C2>(result, *this, matrix, multiplyThread<T, R, C, C2>);
+                return result;
+        }
+
+#ifdef __unix__
+        // INFO: sharded product over the workers of communicator, which must be running distributedServe
+        template <uint64_t C2>
+        Matrix<T, R, C2> multiplyDistributed(const Matrix<T, C, C2> &matrix, const Communicator &communicator, const DistributedOptions &options = DistributedOptions()) const
+        {
+                Matrix<T, R, C2> result(resultStorage<R, C2>(Layout::ROW_MAJOR), Layout::ROW_MAJOR);
+                // INFO: const views, operands already in row-major order are read from their shared buffers without a copy
+                const Matrix<T, R, C> left = toLayout(Layout::ROW_MAJOR);
+                const Matrix<T, C, C2> right = matrix.toLayout(Layout::ROW_MAJOR);
+                distributedMultiply(communicator, left.data(), right.data(), result.data(), R, C, C2, options);
                 return result;
         }
+#endif
 
         Matrix<T, R, C> operator*(const T &scalar) const
         {
-                Matrix<T, R, C> result;
+                Matrix<T, R, C> result(resultStorage<R, C>(mLayout), mLayout);
+                const T *input = mMatrix.data();
+                T *output = result.mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        result.mMatrix[i] = mMatrix[i] * scalar;
+                        output[i] = input[i] * scalar;
                 return result;
         }
 
         Matrix<T, R, C> operator/(const T &scalar) const
         {
-                Matrix<T, R, C> result;
+                Matrix<T, R, C> result(resultStorage<R, C>(mLayout), mLayout);
+                const T *input = mMatrix.data();
+                T *output = result.mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        result.mMatrix[i] = mMatrix[i] / scalar;
+                        output[i] = input[i] / scalar;
                 return result;
         }
 
         Matrix<T, R, C> &operator=(const Matrix<T, R, C> &matrix)
         {
                 mMatrix = matrix.mMatrix;
+                mLayout = matrix.mLayout;
                 return *this;
         }
 
         bool operator==(const Matrix<T, R, C> &matrix) const
         {
+                const HeapArray<T, R*C> other = sameLayout(matrix);
+                const T *left = mMatrix.data();
+                const T *right = other.data();
                 for (uint64_t i = 0; i < R*C; ++i)
                 {
-                        if (mMatrix[i] != matrix.mMatrix[i])
+                        if (left[i] != right[i])
                                 return false;
                 }
                 return true;
@@ -245,49 +282,81 @@ public:
 
         Matrix<T, R, C> &operator+=(const Matrix<T, R, C> &matrix)
         {
+                const HeapArray<T, R*C> other = sameLayout(matrix);
+                const T *right = other.data();
+                T *output = mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        mMatrix[i] += matrix.mMatrix[i];
+                        output[i] += right[i];
                 return *this;
         }
 
         Matrix<T, R, C> &operator-=(const Matrix<T, R, C> &matrix)
         {
+                const HeapArray<T, R*C> other = sameLayout(matrix);
+                const T *right = other.data();
+                T *output = mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        mMatrix[i] -= matrix.mMatrix[i];
+                        output[i] -= right[i];
                 return *this;
         }
 
         Matrix<T, R, C> &operator*=(const Matrix<T, R, C> &matrix)
         {
-                Matrix<T, R, C> result;
-                ThreadFunction<T, R, C> function = reinterpret_cast<ThreadFunction<T, R, C>>(multiplyThread<T, R, C>);
-                dispatchThreads<T, R, C>(result, *this, matrix, function);
+                Matrix<T, R, C> result(resultStorage<R, C>(Layout::ROW_MAJOR), Layout::ROW_MAJOR);
+                dispatchThreads<T, R, C, C>(result, *this, matrix, multiplyThread<T, R, C, C>);
                 *this = result;
                 return *this;
         }
 
         Matrix<T, R, C> &operator*=(const T &scalar)
         {
+                T *output = mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        mMatrix[i] *= scalar;
+                        output[i] *= scalar;
                 return *this;
         }
 
         Matrix<T, R, C> &operator/=(const T &scalar)
         {
+                T *output = mMatrix.data();
                 for (uint64_t i = 0; i < R*C; ++i)
-                        mMatrix[i] /= scalar;
+                        output[i] /= scalar;
                 return *this;
         }
 
         T &operator()(uint64_t row, uint64_t col)
         {
-                return mMatrix[row*C + col];
+                return mMatrix[index(row, col)];
         }
 
         const T &operator()(uint64_t row, uint64_t col) const
         {
-                return mMatrix[row*C + col];
+                return mMatrix[index(row, col)];
+        }
+
+        Layout layout() const
+        {
+                return mLayout;
+        }
+
+        uint64_t rowStride() const
+        {
+                return (mLayout == Layout::ROW_MAJOR) ? C : 1;
+        }
+
+        uint64_t colStride() const
+        {
+                return (mLayout == Layout::ROW_MAJOR) ? 1 : R;
+        }
+
+        const T *data() const
+        {
+                return mMatrix.data();
+        }
+
+        T *data()
+        {
+                return mMatrix.data();
         }
 
         Matrix<T, R, C> &fill(const T &value)
@@ -302,33 +371,62 @@ public:
                 return *this;
         }
 
+        void detach()
+        {
+                mMatrix.detach();
+        }
+
+        bool isUnique() const
+        {
+                return mMatrix.isUnique();
+        }
+
+        void copyOnWrite(bool enabled)
+        {
+                mMatrix.copyOnWrite(enabled);
+        }
+
         Matrix<T, R, C> &diagonal(const T &value)
         {
                 mMatrix.zero();
-                for (uint64_t i = 0; i < R; ++i)
-                        mMatrix[i*C + i] = value;
+                T *output = mMatrix.data();
+                for (uint64_t i = 0; i < std::min(R, C); ++i)
+                        output[index(i, i)] = value;
                 return *this;
         }
 
         Matrix<T, R, C> &identity()
         {
-                mMatrix.zero();
-                for (uint64_t i = 0; i < R; ++i)
-                        mMatrix[i*C + i] = 1;
-                return *this;
+                return diagonal(1);
         }
 
+        // INFO: zero-copy view, the buffer is shared and only the layout tag flips
         Matrix<T, C, R> transpose() const
         {
-                Matrix<T, C, R> result;
-                for (uint64_t i = 0; i < R; ++i)
-                {
-                        for (uint64_t j = 0; j < C; ++j)
-                                result.mMatrix[j*R + i] = mMatrix[i*C + j];
-                }
+                return Matrix<T, C, R>(mMatrix, flipLayout(mLayout));
+        }
+
+        // INFO: same logical matrix stored in the given layout, reordered with the blocked transpose
+        Matrix<T, R, C> toLayout(Layout layout) const
+        {
+                if (layout == mLayout)
+                        return *this;
+                Matrix<T, R, C> result(resultStorage<R, C>(layout), layout);
+                if (mLayout == Layout::ROW_MAJOR)
+                        ::transpose(mMatrix.data(), result.mMatrix.data(), R, C);
+                else
+                        ::transpose(mMatrix.data(), result.mMatrix.data(), C, R);
                 return result;
         }
 
+        Matrix<T, R, C> &transposeInPlace()
+        {
+                if (R != C)
+                        throw std::runtime_error("Matrix must be square to transpose in place.");
+                ::transposeInPlace(mMatrix.data(), R);
+                return *this;
+        }
+
         // TODO: implement inverseInPlace algorithm
         void inverseInPlace();
 
@@ -344,7 +442,7 @@ public:
                 for (uint64_t i = 0; i < R; ++i)
                 {
                         for (uint64_t j = 0; j < C; ++j)
-                                std::cout << mMatrix[i*C + j] << ((j + 1 < C) ? " " : "");
+                                std::cout << (*this)(i, j) << ((j + 1 < C) ? " " : "");
                         std::cout << "\n";
                 }
         }
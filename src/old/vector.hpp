@@ -30,32 +30,42 @@ public:
         Vector<T, N> operator+(const Vector<T, N>& other) const
         {
                 Vector<T, N> result;
+                const T *left = mVector.data();
+                const T *right = other.mVector.data();
+                T *output = result.mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        result.mVector[i] = mVector[i] + other.mVector[i];
+                        output[i] = left[i] + right[i];
                 return result;
         }
 
         Vector<T, N> operator-(const Vector<T, N>& other) const
         {
                 Vector<T, N> result;
+                const T *left = mVector.data();
+                const T *right = other.mVector.data();
+                T *output = result.mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        result.mVector[i] = mVector[i] - other.mVector[i];
+                        output[i] = left[i] - right[i];
                 return result;
         }
 
         Vector<T, N> operator*(const T& scalar) const
         {
                 Vector<T, N> result;
+                const T *input = mVector.data();
+                T *output = result.mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        result.mVector[i] = mVector[i] * scalar;
+                        output[i] = input[i] * scalar;
                 return result;
         }
 
         Vector<T, N> operator/(const T& scalar) const
         {
                 Vector<T, N> result;
+                const T *input = mVector.data();
+                T *output = result.mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        result.mVector[i] = mVector[i] / scalar;
+                        output[i] = input[i] / scalar;
                 return result;
         }
 
@@ -67,9 +77,11 @@ public:
 
         bool operator==(const Vector<T, N>& other) const
         {
+                const T *left = mVector.data();
+                const T *right = other.mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
                 {
-                        if (mVector[i] != other.mVector[i])
+                        if (left[i] != right[i])
                                 return false;
                 }
                 return true;
@@ -99,29 +111,35 @@ public:
 
         Vector<T, N>& operator+=(const Vector<T, N>& other)
         {
+                const T *right = other.mVector.data();
+                T *output = mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        mVector[i] += other.mVector[i];
+                        output[i] += right[i];
                 return *this;
         }
 
         Vector<T, N>& operator-=(const Vector<T, N>& other)
         {
+                const T *right = other.mVector.data();
+                T *output = mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        mVector[i] -= other.mVector[i];
+                        output[i] -= right[i];
                 return *this;
         }
 
         Vector<T, N>& operator*=(const T& scalar)
         {
+                T *output = mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        mVector[i] *= scalar;
+                        output[i] *= scalar;
                 return *this;
         }
 
         Vector<T, N>& operator/=(const T& scalar)
         {
+                T *output = mVector.data();
                 for (uint64_t i = 0; i < N; ++i)
-                        mVector[i] /= scalar;
+                        output[i] /= scalar;
                 return *this;
         }
 
@@ -147,17 +165,29 @@ public:
                 return *this;
         }
 
-        T dot(const Vector<T, N>& other) const
+        void detach()
         {
-                T result = 0;
-                for (uint64_t i = 0; i < N; ++i)
-                        result += mVector[i] * other.mVector[i];
-                return result;
+                mVector.detach();
+        }
+
+        bool isUnique() const
+        {
+                return mVector.isUnique();
+        }
+
+        void copyOnWrite(bool enabled)
+        {
+                mVector.copyOnWrite(enabled);
+        }
+
+        Accumulator<T> dot(const Vector<T, N>& other) const
+        {
+                return mVector.dot(other.mVector);
         }
 
         T magnitude() const
         {
-                return sqrt(dot(*this));
+                return static_cast<T>(sqrt(dot(*this)));
         }
 
         Vector<T, N> normalize() const
@@ -0,0 +1,259 @@
+// INFO: counter-based Philox4x32-10 random number generation for bulk initialization.
+// INFO: every output element is a pure function of (seed, stream, position), so the generated values are
+// INFO: bit-identical no matter how many threads fill the array.
+
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+
+#include "numa.hpp"
+#include "fastmath.hpp"
+
+#define RANDOM_THREADING_THRESHOLD 262'144 // INFO: threading is used only when count > RANDOM_THREADING_THRESHOLD
+#define RANDOM_TRUNCATION 2.0 // INFO: default truncation bound of truncatedNormal, in standard deviations
+
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+
+// INFO: counter = {block low, block high, stream, round}, round is only non-zero when truncatedNormal resamples
+inline std::array<uint32_t, 4> philox(uint64_t block, uint32_t stream, uint32_t round, uint64_t seed)
+{
+        uint32_t c0 = static_cast<uint32_t>(block);
+        uint32_t c1 = static_cast<uint32_t>(block >> 32);
+        uint32_t c2 = stream;
+        uint32_t c3 = round;
+        uint32_t k0 = static_cast<uint32_t>(seed);
+        uint32_t k1 = static_cast<uint32_t>(seed >> 32);
+        for (uint32_t i = 0; i < 10; i++)
+        {
+                uint64_t product0 = uint64_t(PHILOX_M0)*c0;
+                uint64_t product1 = uint64_t(PHILOX_M1)*c2;
+                uint32_t next0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+                uint32_t next2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+                c1 = static_cast<uint32_t>(product1);
+                c3 = static_cast<uint32_t>(product0);
+                c0 = next0;
+                c2 = next2;
+                k0 += PHILOX_W0;
+                k1 += PHILOX_W1;
+        }
+        return {c0, c1, c2, c3};
+}
+
+// INFO: float consumes one 32-bit word per element, double two, so a block covers 4 floats or 2 doubles
+template <typename T>
+struct RandomTraits;
+
+template <>
+struct RandomTraits<float>
+{
+        static constexpr uint64_t perBlock = 4;
+
+        // INFO: 24 random bits in [0, 1)
+        static void uniforms(const std::array<uint32_t, 4> &words, float *result)
+        {
+                for (uint64_t i = 0; i < 4; i++)
+                        result[i] = static_cast<float>(words[i] >> 8)*5.9604644775390625e-8f;
+        }
+
+        // INFO: Box-Muller on the fastmath kernels, words (0, 1) and (2, 3) each give one pair of normals
+        static void normals(const std::array<uint32_t, 4> &words, float *result)
+        {
+                for (uint64_t i = 0; i < 4; i += 2)
+                {
+                        float u1 = static_cast<float>((words[i] >> 8) + 1)*5.9604644775390625e-8f;
+                        float u2 = static_cast<float>(words[i + 1] >> 8)*5.9604644775390625e-8f;
+                        float radius = std::sqrt(-2.0f*logKernel<MathAccuracy::FAITHFUL>(u1));
+                        float sine;
+                        float cosine;
+                        sinCosKernel<MathAccuracy::FAITHFUL>(6.28318530717958647f*u2, sine, cosine);
+                        result[i] = radius*cosine;
+                        result[i + 1] = radius*sine;
+                }
+        }
+};
+
+template <>
+struct RandomTraits<double>
+{
+        static constexpr uint64_t perBlock = 2;
+
+        // INFO: 53 random bits in [0, 1)
+        static double uniform(uint32_t high, uint32_t low)
+        {
+                return static_cast<double>(((uint64_t(high) << 32) | low) >> 11)*1.1102230246251565e-16;
+        }
+
+        static void uniforms(const std::array<uint32_t, 4> &words, double *result)
+        {
+                result[0] = uniform(words[0], words[1]);
+                result[1] = uniform(words[2], words[3]);
+        }
+
+        static void normals(const std::array<uint32_t, 4> &words, double *result)
+        {
+                double u1 = uniform(words[0], words[1]) + 1.1102230246251565e-16;
+                double u2 = uniform(words[2], words[3]);
+                double radius = std::sqrt(-2.0*std::log(u1));
+                result[0] = radius*std::cos(6.283185307179586477*u2);
+                result[1] = radius*std::sin(6.283185307179586477*u2);
+        }
+};
+
+class Philox
+{
+private:
+        uint64_t mSeed;
+        uint32_t mStream;
+        uint64_t mBlock = 0; // INFO: first unused block, every fill starts at a fresh block
+
+        // INFO: generate(block, values) writes RandomTraits<T>::perBlock values, store(index, value) keeps them
+        template <typename T, typename Generate, typename Store>
+        void forEachBlock(uint64_t count, const Generate &generate, const Store &store)
+        {
+                static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value, "Random generation supports float and double.");
+                constexpr uint64_t perBlock = RandomTraits<T>::perBlock;
+                uint64_t blocks = (count + perBlock - 1) / perBlock;
+                uint64_t first = mBlock;
+                auto work = [&](const NumaPartition &partition)
+                {
+                        T values[perBlock];
+                        for (uint64_t block = partition.start; block < partition.end; block++)
+                        {
+                                generate(first + block, values);
+                                for (uint64_t i = 0; i < perBlock && block*perBlock + i < count; i++)
+                                        store(block*perBlock + i, values[i]);
+                        }
+                };
+                uint32_t numThreads = numaThreadCount();
+                if (count > RANDOM_THREADING_THRESHOLD && numThreads > 1)
+                        numaForEachPartition(numaPartition(blocks, numThreads), work);
+                else
+                        work({0, blocks, 0});
+                mBlock += blocks;
+        }
+
+public:
+        Philox(uint64_t seed, uint32_t stream = 0) : mSeed(seed), mStream(stream) {}
+
+        uint64_t seed() const
+        {
+                return mSeed;
+        }
+
+        uint32_t stream() const
+        {
+                return mStream;
+        }
+
+        // INFO: position in blocks of 128 bits, restoring it replays the same values
+        uint64_t position() const
+        {
+                return mBlock;
+        }
+
+        void seek(uint64_t block)
+        {
+                mBlock = block;
+        }
+
+        std::array<uint32_t, 4> operator()(uint64_t block, uint32_t round = 0) const
+        {
+                return philox(block, mStream, round, mSeed);
+        }
+
+        template <typename T>
+        void uniform(T *data, uint64_t count, T low = 0, T high = 1)
+        {
+                T scale = high - low;
+                forEachBlock<T>(count, [this](uint64_t block, T *values)
+                {
+                        RandomTraits<T>::uniforms((*this)(block), values);
+                }, [data, low, scale](uint64_t index, const T &value)
+                {
+                        data[index] = low + scale*value;
+                });
+        }
+
+        template <typename T>
+        void normal(T *data, uint64_t count, T mean = 0, T stddev = 1)
+        {
+                forEachBlock<T>(count, [this](uint64_t block, T *values)
+                {
+                        RandomTraits<T>::normals((*this)(block), values);
+                }, [data, mean, stddev](uint64_t index, const T &value)
+                {
+                        data[index] = mean + stddev*value;
+                });
+        }
+
+        // INFO: normal values outside bound standard deviations are redrawn from the same counter with the
+        // INFO: next round, so resampling stays independent of the thread count
+        template <typename T>
+        void truncatedNormal(T *data, uint64_t count, T mean = 0, T stddev = 1, T bound = RANDOM_TRUNCATION)
+        {
+                if (!(bound > 0))
+                        throw std::runtime_error("Truncation bound must be positive.");
+                constexpr uint64_t perBlock = RandomTraits<T>::perBlock;
+                forEachBlock<T>(count, [this, bound](uint64_t block, T *values)
+                {
+                        RandomTraits<T>::normals((*this)(block), values);
+                        for (uint64_t i = 0; i < perBlock; i++)
+                        {
+                                T redrawn[perBlock];
+                                for (uint32_t round = 1; !(std::fabs(values[i]) <= bound); round++)
+                                {
+                                        RandomTraits<T>::normals((*this)(block, round), redrawn);
+                                        values[i] = redrawn[i];
+                                }
+                        }
+                }, [data, mean, stddev](uint64_t index, const T &value)
+                {
+                        data[index] = mean + stddev*value;
+                });
+        }
+
+        // INFO: Glorot/Xavier initialization, U(-gain*sqrt(6/(fanIn + fanOut)), gain*sqrt(6/(fanIn + fanOut)))
+        template <typename T>
+        void xavierUniform(T *data, uint64_t count, uint64_t fanIn, uint64_t fanOut, T gain = 1)
+        {
+                T limit = gain*std::sqrt(T(6)/static_cast<T>(fanIn + fanOut));
+                uniform(data, count, -limit, limit);
+        }
+
+        template <typename T>
+        void xavierNormal(T *data, uint64_t count, uint64_t fanIn, uint64_t fanOut, T gain = 1)
+        {
+                normal(data, count, T(0), gain*std::sqrt(T(2)/static_cast<T>(fanIn + fanOut)));
+        }
+
+        // INFO: He (Kaiming) initialization for ReLU layers, U(-sqrt(6/fanIn), sqrt(6/fanIn))
+        template <typename T>
+        void heUniform(T *data, uint64_t count, uint64_t fanIn)
+        {
+                T limit = std::sqrt(T(6)/static_cast<T>(fanIn));
+                uniform(data, count, -limit, limit);
+        }
+
+        template <typename T>
+        void heNormal(T *data, uint64_t count, uint64_t fanIn)
+        {
+                normal(data, count, T(0), std::sqrt(T(2)/static_cast<T>(fanIn)));
+        }
+
+        // INFO: truncated at two standard deviations, the stddev is corrected for the lost tails
+        template <typename T>
+        void heTruncatedNormal(T *data, uint64_t count, uint64_t fanIn)
+        {
+                truncatedNormal(data, count, T(0), std::sqrt(T(2)/static_cast<T>(fanIn)) / T(0.87962566103423978), T(2));
+        }
+};
+
+#endif // RANDOM_HPP
@@ -0,0 +1,304 @@
+// INFO: reductions over contiguous arrays with wide accumulators and optional compensated summation.
+// INFO: arrays are split into fixed-size blocks that are combined in a fixed pairwise tree,
+// INFO: so results are bit-identical no matter how many threads take part.
+
+#ifndef REDUCTION_HPP
+#define REDUCTION_HPP
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <type_traits>
+
+#include "numa.hpp"
+
+#define REDUCTION_BLOCK_SIZE 65'536 // INFO: elements per block, never depends on the thread count
+#define REDUCTION_LANES 8 // INFO: independent accumulators per block, lets the compiler vectorize the inner loop
+#define REDUCTION_PAIRWISE_BASE 128 // INFO: pairwise summation falls back to lane summation below this size
+#define REDUCTION_THREADING_THRESHOLD 4'194'304 // INFO: threading is used only when count > REDUCTION_THREADING_THRESHOLD
+
+enum class SummationMode
+{
+        NAIVE,
+        PAIRWISE,
+        KAHAN,
+        NEUMAIER
+};
+
+template <typename T, typename Enable = void>
+struct ReductionAccumulator
+{
+        using type = T;
+};
+
+template <>
+struct ReductionAccumulator<float>
+{
+        using type = double;
+};
+
+template <typename T>
+struct ReductionAccumulator<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type>
+{
+        using type = int64_t;
+};
+
+template <typename T>
+struct ReductionAccumulator<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value>::type>
+{
+        using type = uint64_t;
+};
+
+template <typename T>
+using Accumulator = typename ReductionAccumulator<T>::type;
+
+// INFO: norms of integer arrays are returned as double
+template <typename T>
+using NormAccumulator = typename std::conditional<std::is_floating_point<Accumulator<T>>::value, Accumulator<T>, double>::type;
+
+// INFO: the represented value is sum + compensation for every summation mode
+template <typename A>
+struct CompensatedSum
+{
+        A sum = 0;
+        A compensation = 0;
+
+        A value() const
+        {
+                return sum + compensation;
+        }
+};
+
+template <typename T>
+struct ReductionIndex
+{
+        T value;
+        uint64_t index;
+};
+
+template <typename A>
+A reductionAbs(const A &value)
+{
+        if constexpr (std::is_unsigned<A>::value)
+                return value;
+        else
+                return (value < 0) ? -value : value;
+}
+
+template <SummationMode Mode, typename A>
+void accumulate(CompensatedSum<A> &accumulator, const A &value)
+{
+        if constexpr (std::is_floating_point<A>::value && Mode == SummationMode::KAHAN)
+        {
+                A y = value + accumulator.compensation;
+                A t = accumulator.sum + y;
+                accumulator.compensation = y - (t - accumulator.sum);
+                accumulator.sum = t;
+        }
+        else if constexpr (std::is_floating_point<A>::value && Mode == SummationMode::NEUMAIER)
+        {
+                A t = accumulator.sum + value;
+                if (reductionAbs(accumulator.sum) >= reductionAbs(value))
+                        accumulator.compensation += (accumulator.sum - t) + value;
+                else
+                        accumulator.compensation += (value - t) + accumulator.sum;
+                accumulator.sum = t;
+        }
+        else
+        {
+                accumulator.sum += value;
+        }
+}
+
+template <SummationMode Mode, typename A>
+CompensatedSum<A> combineSums(const CompensatedSum<A> &left, const CompensatedSum<A> &right)
+{
+        CompensatedSum<A> result = left;
+        accumulate<Mode>(result, right.sum);
+        result.compensation += right.compensation;
+        return result;
+}
+
+template <SummationMode Mode, typename A, typename Load>
+CompensatedSum<A> sumLanes(uint64_t begin, uint64_t end, const Load &load)
+{
+        CompensatedSum<A> lanes[REDUCTION_LANES] = {};
+        uint64_t i = begin;
+        for (; i + REDUCTION_LANES <= end; i += REDUCTION_LANES)
+        {
+                for (uint64_t lane = 0; lane < REDUCTION_LANES; lane++)
+                        accumulate<Mode>(lanes[lane], static_cast<A>(load(i + lane)));
+        }
+        for (; i < end; i++)
+                accumulate<Mode>(lanes[0], static_cast<A>(load(i)));
+        for (uint64_t width = REDUCTION_LANES / 2; width > 0; width /= 2)
+        {
+                for (uint64_t lane = 0; lane < width; lane++)
+                        lanes[lane] = combineSums<Mode>(lanes[lane], lanes[lane + width]);
+        }
+        return lanes[0];
+}
+
+template <typename A, typename Load>
+CompensatedSum<A> sumPairwise(uint64_t begin, uint64_t end, const Load &load)
+{
+        if (end - begin <= REDUCTION_PAIRWISE_BASE)
+                return sumLanes<SummationMode::NAIVE, A>(begin, end, load);
+        uint64_t middle = begin + (end - begin) / 2;
+        return combineSums<SummationMode::NAIVE>(sumPairwise<A>(begin, middle, load), sumPairwise<A>(middle, end, load));
+}
+
+// INFO: reduces every block into its own slot, then combines the slots pairwise in block order
+template <typename Partial, typename BlockFunction, typename CombineFunction>
+Partial reduceBlocks(uint64_t count, const BlockFunction &block, const CombineFunction &combine)
+{
+        uint64_t blocks = (count == 0) ? 1 : (count + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+        std::vector<Partial> partials(blocks);
+        auto work = [&](const NumaPartition &partition)
+        {
+                for (uint64_t i = partition.start; i < partition.end; i++)
+                        partials[i] = block(i*REDUCTION_BLOCK_SIZE, std::min(count, (i + 1)*REDUCTION_BLOCK_SIZE));
+        };
+        uint64_t numThreads = std::min<uint64_t>(numaThreadCount(), blocks);
+        if (count > REDUCTION_THREADING_THRESHOLD && numThreads > 1)
+                numaForEachPartition(numaPartition(blocks, numThreads), work);
+        else
+                work({0, blocks, 0});
+        for (uint64_t width = 1; width < blocks; width *= 2)
+        {
+                for (uint64_t i = 0; i + width < blocks; i += 2*width)
+                        partials[i] = combine(partials[i], partials[i + width]);
+        }
+        return partials[0];
+}
+
+template <SummationMode Mode, typename A, typename Load>
+A reduceSumWith(uint64_t count, const Load &load)
+{
+        auto block = [&load](uint64_t begin, uint64_t end)
+        {
+                if constexpr (Mode == SummationMode::PAIRWISE)
+                        return sumPairwise<A>(begin, end, load);
+                else
+                        return sumLanes<Mode, A>(begin, end, load);
+        };
+        constexpr SummationMode combineMode = (Mode == SummationMode::PAIRWISE) ? SummationMode::NAIVE : Mode;
+        return reduceBlocks<CompensatedSum<A>>(count, block, combineSums<combineMode, A>).value();
+}
+
+template <typename A, typename Load>
+A reduceSumMode(uint64_t count, const Load &load, SummationMode mode)
+{
+        switch (mode)
+        {
+        case SummationMode::NAIVE:
+                return reduceSumWith<SummationMode::NAIVE, A>(count, load);
+        case SummationMode::PAIRWISE:
+                return reduceSumWith<SummationMode::PAIRWISE, A>(count, load);
+        case SummationMode::KAHAN:
+                return reduceSumWith<SummationMode::KAHAN, A>(count, load);
+        case SummationMode::NEUMAIER:
+                return reduceSumWith<SummationMode::NEUMAIER, A>(count, load);
+        }
+        throw std::runtime_error("Unknown summation mode.");
+}
+
+template <typename T>
+Accumulator<T> reduceSum(const T *data, uint64_t count, SummationMode mode = SummationMode::PAIRWISE)
+{
+        return reduceSumMode<Accumulator<T>>(count, [data](uint64_t i) { return data[i]; }, mode);
+}
+
+template <typename T>
+Accumulator<T> reduceDot(const T *data1, const T *data2, uint64_t count, SummationMode mode = SummationMode::PAIRWISE)
+{
+        using A = Accumulator<T>;
+        return reduceSumMode<A>(count, [data1, data2](uint64_t i) { return static_cast<A>(data1[i]) * static_cast<A>(data2[i]); }, mode);
+}
+
+template <typename T>
+Accumulator<T> reduceProduct(const T *data, uint64_t count)
+{
+        using A = Accumulator<T>;
+        auto block = [data](uint64_t begin, uint64_t end)
+        {
+                A lanes[REDUCTION_LANES];
+                std::fill(lanes, lanes + REDUCTION_LANES, A(1));
+                uint64_t i = begin;
+                for (; i + REDUCTION_LANES <= end; i += REDUCTION_LANES)
+                {
+                        for (uint64_t lane = 0; lane < REDUCTION_LANES; lane++)
+                                lanes[lane] *= static_cast<A>(data[i + lane]);
+                }
+                for (; i < end; i++)
+                        lanes[0] *= static_cast<A>(data[i]);
+                for (uint64_t width = REDUCTION_LANES / 2; width > 0; width /= 2)
+                {
+                        for (uint64_t lane = 0; lane < width; lane++)
+                                lanes[lane] *= lanes[lane + width];
+                }
+                return lanes[0];
+        };
+        return reduceBlocks<A>(count, block, [](const A &left, const A &right) { return left * right; });
+}
+
+template <typename T>
+NormAccumulator<T> reduceNorm1(const T *data, uint64_t count, SummationMode mode = SummationMode::PAIRWISE)
+{
+        using A = NormAccumulator<T>;
+        return reduceSumMode<A>(count, [data](uint64_t i) { return reductionAbs(static_cast<A>(data[i])); }, mode);
+}
+
+template <typename T>
+NormAccumulator<T> reduceNorm2(const T *data, uint64_t count, SummationMode mode = SummationMode::PAIRWISE)
+{
+        using A = NormAccumulator<T>;
+        return std::sqrt(reduceSumMode<A>(count, [data](uint64_t i) { return static_cast<A>(data[i]) * static_cast<A>(data[i]); }, mode));
+}
+
+// INFO: ties resolve to the lowest index; Better(a, b) is true when a should replace b
+template <typename T, typename Better>
+ReductionIndex<T> reduceIndex(const T *data, uint64_t count, const Better &better)
+{
+        if (count == 0)
+                throw std::runtime_error("Cannot reduce an empty array.");
+        auto block = [data, &better](uint64_t begin, uint64_t end)
+        {
+                ReductionIndex<T> result = {data[begin], begin};
+                for (uint64_t i = begin + 1; i < end; i++)
+                {
+                        if (better(data[i], result.value))
+                                result = {data[i], i};
+                }
+                return result;
+        };
+        auto combine = [&better](const ReductionIndex<T> &left, const ReductionIndex<T> &right)
+        {
+                return better(right.value, left.value) ? right : left;
+        };
+        return reduceBlocks<ReductionIndex<T>>(count, block, combine);
+}
+
+template <typename T>
+ReductionIndex<T> reduceMin(const T *data, uint64_t count)
+{
+        return reduceIndex(data, count, [](const T &a, const T &b) { return a < b; });
+}
+
+template <typename T>
+ReductionIndex<T> reduceMax(const T *data, uint64_t count)
+{
+        return reduceIndex(data, count, [](const T &a, const T &b) { return a > b; });
+}
+
+template <typename T>
+T reduceNormInf(const T *data, uint64_t count)
+{
+        if (count == 0)
+                return 0;
+        return reductionAbs(reduceIndex(data, count, [](const T &a, const T &b) { return reductionAbs(a) > reductionAbs(b); }).value);
+}
+
+#endif // REDUCTION_HPP
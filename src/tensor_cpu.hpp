@@ -7,6 +7,7 @@
 #include <stdexcept>
 
 #include "heaparray.hpp"
+#include "transpose.hpp"
 
 template <typename T, uint64_t R, uint64_t S>
 class Tensor
@@ -14,7 +15,33 @@ class Tensor
 private:
         HeapArray<T, S> mTensor;
         std::array<uint64_t, R> mShape;
-        std::array<uint64_t, R> mStrides; // INFO: row-major order
+        std::array<uint64_t, R> mStrides; // INFO: row-major order unless mLayout says otherwise
+        Layout mLayout = Layout::ROW_MAJOR;
+
+        static uint64_t outerStride(const std::array<uint64_t, R> &shape)
+        {
+                uint64_t stride = 1;
+                for (uint64_t i = 1; i < R; i++)
+                        stride *= shape[i];
+                return stride;
+        }
+
+        void setShape(const std::array<uint64_t, R> &shape, Layout layout = Layout::ROW_MAJOR)
+        {
+                if (shape.size() != R)
+                        throw std::runtime_error("Shape must have the same rank as the tensor.");
+                mShape = shape;
+                mLayout = layout;
+                mStrides.fill(1);
+                for (uint64_t i = 0; i < R; i++)
+                {
+                        for (uint64_t j = 0; j < R; j++)
+                        {
+                                if ((layout == Layout::ROW_MAJOR) ? j > i : j < i)
+                                        mStrides[i] *= mShape[j];
+                        }
+                }
+        }
 
 public:
         Tensor() : mTensor()
@@ -39,20 +66,23 @@ public:
         {
                 mShape = tensor.mShape;
                 mStrides = tensor.mStrides;
+                mLayout = tensor.mLayout;
         }
 
         Tensor(const std::array<uint64_t, R> &shape) : mTensor()
         {
-                if (shape.size() != R)
-                        throw std::runtime_error("Shape must have the same rank as the tensor.");
-                mShape = shape;
-                for (uint64_t i = 0; i < R; i++)
-                {
-                        for (uint64_t j = i + 1; j < R; j++)
-                        {
-                                mStrides[i] *= mShape[j];
-                        }
-                }
+                setShape(shape);
+        }
+
+        Tensor(const std::array<uint64_t, R> &shape, Layout layout) : mTensor()
+        {
+                setShape(shape, layout);
+        }
+
+        // INFO: BLOCKED placement splits the tensor along its outermost dimension
+        Tensor(const std::array<uint64_t, R> &shape, NumaPolicy policy) : mTensor(policy, outerStride(shape))
+        {
+                setShape(shape);
         }
 
         ~Tensor() = default;
@@ -62,6 +92,7 @@ public:
                 mTensor = tensor.mTensor;
                 mShape = tensor.mShape;
                 mStrides = tensor.mStrides;
+                mLayout = tensor.mLayout;
                 return *this;
         }
 
@@ -70,10 +101,11 @@ public:
         {
                 if (sizeof...(args) != R)
                         throw std::runtime_error("Number of arguments must match the rank of the tensor.");
+                const uint64_t indices[] = {static_cast<uint64_t>(args)...};
                 uint64_t index = 0;
                 for (uint64_t i = 0; i < R; i++)
                 {
-                        index += mStrides[i] * args[i];
+                        index += mStrides[i] * indices[i];
                 }
                 return mTensor[index];
         }
@@ -83,10 +115,11 @@ public:
         {
                 if (sizeof...(args) != R)
                         throw std::runtime_error("Number of arguments must match the rank of the tensor.");
+                const uint64_t indices[] = {static_cast<uint64_t>(args)...};
                 uint64_t index = 0;
                 for (uint64_t i = 0; i < R; i++)
                 {
-                        index += mStrides[i] * args[i];
+                        index += mStrides[i] * indices[i];
                 }
                 return mTensor[index];
         }
@@ -101,6 +134,36 @@ public:
                 mTensor.zero();
         }
 
+        void fillUniform(Philox &generator, const T &low = 0, const T &high = 1)
+        {
+                mTensor.fillUniform(generator, low, high);
+        }
+
+        void fillNormal(Philox &generator, const T &mean = 0, const T &stddev = 1)
+        {
+                mTensor.fillNormal(generator, mean, stddev);
+        }
+
+        void fillTruncatedNormal(Philox &generator, const T &mean = 0, const T &stddev = 1, const T &bound = RANDOM_TRUNCATION)
+        {
+                mTensor.fillTruncatedNormal(generator, mean, stddev, bound);
+        }
+
+        void detach()
+        {
+                mTensor.detach();
+        }
+
+        bool isUnique() const
+        {
+                return mTensor.isUnique();
+        }
+
+        void copyOnWrite(bool enabled)
+        {
+                mTensor.copyOnWrite(enabled);
+        }
+
         void print() const
         {
                 for (uint64_t i = 0; i < S; i++)
@@ -113,6 +176,16 @@ public:
                 return S;
         }
 
+        const T *data() const
+        {
+                return mTensor.data();
+        }
+
+        T *data()
+        {
+                return mTensor.data();
+        }
+
         uint64_t rank() const
         {
                 return R;
@@ -127,6 +200,24 @@ public:
         {
                 return mStrides;
         }
+
+        Layout layout() const
+        {
+                return mLayout;
+        }
+
+        // INFO: zero-copy view with reversed axes, the buffer is shared and the layout tag flips
+        Tensor<T, R, S> transpose() const
+        {
+                Tensor<T, R, S> result(*this);
+                for (uint64_t i = 0; i < R; i++)
+                {
+                        result.mShape[i] = mShape[R - 1 - i];
+                        result.mStrides[i] = mStrides[R - 1 - i];
+                }
+                result.mLayout = flipLayout(mLayout);
+                return result;
+        }
 };
 
 #endif // TENSOR_HPP
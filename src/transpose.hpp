@@ -0,0 +1,185 @@
+// INFO: cache-oblivious blocked transpose for row-major buffers, out of place and in place for square matrices.
+
+#ifndef TRANSPOSE_HPP
+#define TRANSPOSE_HPP
+
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+
+#include "numa.hpp"
+
+#define TRANSPOSE_TILE 8 // INFO: micro-tile edge, a whole tile is held in registers while it is transposed
+#define TRANSPOSE_BLOCK 64 // INFO: recursion stops once both sides of a block are at most TRANSPOSE_BLOCK
+#define TRANSPOSE_THREADING_THRESHOLD 1'048'576 // INFO: threading is used only when rows*cols > TRANSPOSE_THREADING_THRESHOLD
+
+enum class Layout
+{
+        ROW_MAJOR,
+        COLUMN_MAJOR
+};
+
+inline Layout flipLayout(Layout layout)
+{
+        return (layout == Layout::ROW_MAJOR) ? Layout::COLUMN_MAJOR : Layout::ROW_MAJOR;
+}
+
+template <typename T>
+void transposeTile(const T *source, uint64_t sourceStride, T *destination, uint64_t destinationStride)
+{
+        T tile[TRANSPOSE_TILE][TRANSPOSE_TILE];
+        for (uint64_t i = 0; i < TRANSPOSE_TILE; i++)
+        {
+                for (uint64_t j = 0; j < TRANSPOSE_TILE; j++)
+                        tile[j][i] = source[i*sourceStride + j];
+        }
+        for (uint64_t i = 0; i < TRANSPOSE_TILE; i++)
+        {
+                for (uint64_t j = 0; j < TRANSPOSE_TILE; j++)
+                        destination[i*destinationStride + j] = tile[i][j];
+        }
+}
+
+template <typename T>
+void transposeBlock(const T *source, uint64_t rows, uint64_t cols, uint64_t sourceStride, T *destination, uint64_t destinationStride)
+{
+        uint64_t fullRows = rows - rows % TRANSPOSE_TILE;
+        uint64_t fullCols = cols - cols % TRANSPOSE_TILE;
+        for (uint64_t i = 0; i < fullRows; i += TRANSPOSE_TILE)
+        {
+                for (uint64_t j = 0; j < fullCols; j += TRANSPOSE_TILE)
+                        transposeTile(source + i*sourceStride + j, sourceStride, destination + j*destinationStride + i, destinationStride);
+        }
+        for (uint64_t i = 0; i < rows; i++)
+        {
+                for (uint64_t j = (i < fullRows) ? fullCols : 0; j < cols; j++)
+                        destination[j*destinationStride + i] = source[i*sourceStride + j];
+        }
+}
+
+// INFO: halves are kept at multiples of TRANSPOSE_TILE so that full tiles never straddle a split
+inline uint64_t transposeSplit(uint64_t size)
+{
+        return (size / 2 + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE * TRANSPOSE_TILE;
+}
+
+template <typename T>
+void transposeRecursive(const T *source, uint64_t rows, uint64_t cols, uint64_t sourceStride, T *destination, uint64_t destinationStride)
+{
+        if (rows <= TRANSPOSE_BLOCK && cols <= TRANSPOSE_BLOCK)
+        {
+                transposeBlock(source, rows, cols, sourceStride, destination, destinationStride);
+                return;
+        }
+        if (rows >= cols)
+        {
+                uint64_t half = transposeSplit(rows);
+                transposeRecursive(source, half, cols, sourceStride, destination, destinationStride);
+                transposeRecursive(source + half*sourceStride, rows - half, cols, sourceStride, destination + half, destinationStride);
+                return;
+        }
+        uint64_t half = transposeSplit(cols);
+        transposeRecursive(source, rows, half, sourceStride, destination, destinationStride);
+        transposeRecursive(source + half, rows, cols - half, sourceStride, destination + half*destinationStride, destinationStride);
+}
+
+// INFO: destination receives the cols x rows row-major transpose of the rows x cols row-major source
+template <typename T>
+void transpose(const T *source, T *destination, uint64_t rows, uint64_t cols)
+{
+        uint32_t numThreads = numaThreadCount();
+        if (rows*cols <= TRANSPOSE_THREADING_THRESHOLD || numThreads < 2 || rows < numThreads*TRANSPOSE_TILE)
+        {
+                transposeRecursive(source, rows, cols, cols, destination, rows);
+                return;
+        }
+        // INFO: each thread transposes a strip of rows, aligned to tiles, into a strip of destination columns
+        uint64_t tiles = (rows + TRANSPOSE_TILE - 1) / TRANSPOSE_TILE;
+        numaForEachPartition(numaPartition(tiles, numThreads), [&](const NumaPartition &partition)
+        {
+                uint64_t start = partition.start*TRANSPOSE_TILE;
+                uint64_t end = std::min(rows, partition.end*TRANSPOSE_TILE);
+                transposeRecursive(source + start*cols, end - start, cols, cols, destination + start, rows);
+        });
+}
+
+template <typename T>
+void transposeSwapTile(T *first, T *second, uint64_t stride)
+{
+        T tile1[TRANSPOSE_TILE][TRANSPOSE_TILE];
+        T tile2[TRANSPOSE_TILE][TRANSPOSE_TILE];
+        for (uint64_t i = 0; i < TRANSPOSE_TILE; i++)
+        {
+                for (uint64_t j = 0; j < TRANSPOSE_TILE; j++)
+                {
+                        tile1[j][i] = first[i*stride + j];
+                        tile2[j][i] = second[i*stride + j];
+                }
+        }
+        for (uint64_t i = 0; i < TRANSPOSE_TILE; i++)
+        {
+                for (uint64_t j = 0; j < TRANSPOSE_TILE; j++)
+                {
+                        first[i*stride + j] = tile2[i][j];
+                        second[i*stride + j] = tile1[i][j];
+                }
+        }
+}
+
+// INFO: swaps the rows x cols block at first with the transpose of the cols x rows block at second
+template <typename T>
+void transposeSwapRecursive(T *first, T *second, uint64_t rows, uint64_t cols, uint64_t stride)
+{
+        if (rows <= TRANSPOSE_BLOCK && cols <= TRANSPOSE_BLOCK)
+        {
+                uint64_t fullRows = rows - rows % TRANSPOSE_TILE;
+                uint64_t fullCols = cols - cols % TRANSPOSE_TILE;
+                for (uint64_t i = 0; i < fullRows; i += TRANSPOSE_TILE)
+                {
+                        for (uint64_t j = 0; j < fullCols; j += TRANSPOSE_TILE)
+                                transposeSwapTile(first + i*stride + j, second + j*stride + i, stride);
+                }
+                for (uint64_t i = 0; i < rows; i++)
+                {
+                        for (uint64_t j = (i < fullRows) ? fullCols : 0; j < cols; j++)
+                                std::swap(first[i*stride + j], second[j*stride + i]);
+                }
+                return;
+        }
+        if (rows >= cols)
+        {
+                uint64_t half = transposeSplit(rows);
+                transposeSwapRecursive(first, second, half, cols, stride);
+                transposeSwapRecursive(first + half*stride, second + half, rows - half, cols, stride);
+                return;
+        }
+        uint64_t half = transposeSplit(cols);
+        transposeSwapRecursive(first, second, rows, half, stride);
+        transposeSwapRecursive(first + half, second + half*stride, rows, cols - half, stride);
+}
+
+template <typename T>
+void transposeInPlaceRecursive(T *data, uint64_t size, uint64_t stride)
+{
+        if (size <= TRANSPOSE_BLOCK)
+        {
+                for (uint64_t i = 0; i < size; i++)
+                {
+                        for (uint64_t j = i + 1; j < size; j++)
+                                std::swap(data[i*stride + j], data[j*stride + i]);
+                }
+                return;
+        }
+        uint64_t half = transposeSplit(size);
+        transposeInPlaceRecursive(data, half, stride);
+        transposeInPlaceRecursive(data + half*stride + half, size - half, stride);
+        transposeSwapRecursive(data + half, data + half*stride, half, size - half, stride);
+}
+
+template <typename T>
+void transposeInPlace(T *data, uint64_t size)
+{
+        transposeInPlaceRecursive(data, size, size);
+}
+
+#endif // TRANSPOSE_HPP
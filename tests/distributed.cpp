@@ -0,0 +1,209 @@
+// INFO: localhost check of the multi-process code paths: forked workers over socket pairs, TCP on loopback
+// INFO: and a Unix socket path, both transports, the collectives and Matrix::multiplyDistributed.
+// INFO: every distributed product is compared with the single-process one, the program exits with a non-zero
+// INFO: status when any check fails. Run with make test.
+
+#include <iostream>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+
+#include "old/matrix.hpp"
+
+#define TEST_WORKERS 3
+#define TEST_CONNECT_ATTEMPTS 200 // INFO: workers started with fork retry until the coordinator listens
+#define TEST_CONNECT_DELAY 10'000 // INFO: microseconds between connection attempts
+#define TEST_SEGMENTS 18 // INFO: shared memory multiplies of the three runs, each creates one segment
+
+// INFO: operands hold small integers, so every summation order gives the same product exactly
+template <typename T, uint64_t R, uint64_t C>
+Matrix<T, R, C> testMatrix(uint64_t seed)
+{
+        Matrix<T, R, C> result;
+        for (uint64_t i = 0; i < R; i++)
+        {
+                for (uint64_t j = 0; j < C; j++)
+                        result(i, j) = static_cast<T>(static_cast<int64_t>((i*7 + j*3 + seed) % 11) - 5);
+        }
+        return result;
+}
+
+bool report(const std::string &name, bool passed)
+{
+        std::cout << (passed ? "PASS " : "FAIL ") << name << "\n";
+        return passed;
+}
+
+// INFO: runs the same sequence on every rank, the coordinator checks the results
+bool collectives(const Communicator &communicator)
+{
+        uint32_t rank = communicator.rank();
+        uint32_t size = communicator.size();
+        communicator.barrier();
+
+        int64_t broadcast[3] = {int64_t(rank), int64_t(rank)*10, -1};
+        communicator.broadcast(broadcast, 3, size - 1);
+        bool passed = broadcast[0] == int64_t(size - 1) && broadcast[1] == int64_t(size - 1)*10 && broadcast[2] == -1;
+
+        double values[2] = {double(rank), 1.0};
+        double sums[2] = {};
+        communicator.allReduce(values, sums, 2);
+        passed &= sums[0] == double(size*(size - 1)/2) && sums[1] == double(size);
+
+        std::vector<int32_t> gathered(2*size);
+        int32_t local[2] = {int32_t(rank), -int32_t(rank)};
+        communicator.allGather(local, gathered.data(), 2);
+        for (uint32_t i = 0; i < size; i++)
+                passed &= gathered[2*i] == int32_t(i) && gathered[2*i + 1] == -int32_t(i);
+        return passed;
+}
+
+void worker(Communicator &communicator)
+{
+        if (!collectives(communicator))
+                throw std::runtime_error("Collectives returned wrong values.");
+        distributedServe(communicator);
+}
+
+bool multiplications(const Communicator &communicator, const std::string &prefix)
+{
+        const Matrix<double, 37, 29> a = testMatrix<double, 37, 29>(1);
+        const Matrix<double, 29, 41> b = testMatrix<double, 29, 41>(2);
+        const Matrix<double, 37, 41> expected = a * b;
+        // INFO: column-major operands, multiplyDistributed converts them before they are sent
+        const Matrix<double, 37, 29> aColumns = testMatrix<double, 29, 37>(3).transpose();
+        const Matrix<double, 29, 41> bColumns = testMatrix<double, 41, 29>(4).transpose();
+        const Matrix<double, 37, 41> expectedColumns = aColumns * bColumns;
+
+        bool passed = true;
+        for (Transport transport : {Transport::SOCKET, Transport::SHARED_MEMORY})
+        {
+                std::string name = prefix + ((transport == Transport::SOCKET) ? " socket" : " shared memory");
+                for (uint64_t tile : {uint64_t(8), uint64_t(DISTRIBUTED_TILE)})
+                {
+                        DistributedOptions options;
+                        options.transport = transport;
+                        options.tile = tile;
+                        std::string suffix = " tile " + std::to_string(tile);
+                        passed &= report(name + " multiply" + suffix, a.multiplyDistributed(b, communicator, options) == expected);
+                        passed &= report(name + " transposed multiply" + suffix, aColumns.multiplyDistributed(bColumns, communicator, options) == expectedColumns);
+                }
+                // INFO: a 1 x 3 grid leaves whole tile rows and columns to single workers
+                DistributedOptions options;
+                options.transport = transport;
+                options.tile = 8;
+                options.gridRows = 1;
+                options.gridCols = TEST_WORKERS;
+                passed &= report(name + " multiply 1 x 3 grid", a.multiplyDistributed(b, communicator, options) == expected);
+
+                std::vector<int32_t> left(5*7);
+                std::vector<int32_t> right(7*3);
+                std::vector<int32_t> local(5*3);
+                std::vector<int32_t> result(5*3);
+                for (uint64_t i = 0; i < left.size(); i++)
+                        left[i] = int32_t(i % 9) - 4;
+                for (uint64_t i = 0; i < right.size(); i++)
+                        right[i] = int32_t(i % 5) - 2;
+                gemmTile(left.data(), 7, right.data(), 3, local.data(), 3, 5, 7, 3);
+                distributedMultiply(communicator, left.data(), right.data(), result.data(), 5, 7, 3, options);
+                passed &= report(name + " int32 multiply", result == local);
+        }
+        return passed;
+}
+
+// INFO: forks TEST_WORKERS processes that connect through connect and serve until distributedStop
+void forkWorkers(const std::function<Communicator()> &connect)
+{
+        for (uint32_t i = 0; i < TEST_WORKERS; i++)
+        {
+                if (fork() != 0)
+                        continue;
+                int status = 1;
+                bool connected = false;
+                for (uint32_t attempt = 0; attempt < TEST_CONNECT_ATTEMPTS && !connected; attempt++)
+                {
+                        try
+                        {
+                                Communicator communicator = connect();
+                                connected = true;
+                                worker(communicator);
+                                status = 0;
+                        }
+                        catch (const std::exception &exception)
+                        {
+                                // INFO: only a failed connection is retried, errors after it fail the worker
+                                if (connected)
+                                        std::cerr << "Worker: " << exception.what() << "\n";
+                                else
+                                        usleep(TEST_CONNECT_DELAY);
+                        }
+                }
+                _exit(status);
+        }
+}
+
+bool reapWorkers()
+{
+        bool passed = true;
+        for (uint32_t i = 0; i < TEST_WORKERS; i++)
+        {
+                int status = 0;
+                if (wait(&status) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+                        passed = false;
+        }
+        return passed;
+}
+
+bool run(Communicator &communicator, const std::string &name)
+{
+        bool passed = report(name + " collectives", collectives(communicator));
+        passed &= multiplications(communicator, name);
+        distributedStop(communicator);
+        return passed;
+}
+
+int main()
+{
+        signal(SIGPIPE, SIG_IGN);
+        bool passed = true;
+        {
+                // INFO: spawn forks, so it runs before anything in this process starts a thread
+                Communicator communicator = Communicator::spawn(TEST_WORKERS, worker);
+                passed &= run(communicator, "forked");
+                passed &= report("forked workers exited cleanly", communicator.wait());
+        }
+        {
+                uint16_t port = static_cast<uint16_t>(40'000 + getpid() % 20'000);
+                forkWorkers([port]() { return Communicator::connect("127.0.0.1", port); });
+                Communicator communicator = Communicator::listen(port, TEST_WORKERS);
+                passed &= run(communicator, "tcp");
+                passed &= report("tcp workers exited cleanly", reapWorkers());
+        }
+        {
+                std::string path = "/tmp/totality-test-" + std::to_string(getpid()) + ".sock";
+                forkWorkers([path]() { return Communicator::connectUnix(path); });
+                Communicator communicator = Communicator::listenUnix(path, TEST_WORKERS);
+                passed &= run(communicator, "unix");
+                passed &= report("unix workers exited cleanly", reapWorkers());
+        }
+
+        // INFO: segments are named after the coordinator's pid and a counter, all of them must be unlinked by now
+        bool unlinked = true;
+        for (uint64_t i = 0; i < TEST_SEGMENTS; i++)
+        {
+                std::string name = "/totality-" + std::to_string(getpid()) + "-" + std::to_string(i);
+                int descriptor = shm_open(name.c_str(), O_RDONLY, 0600);
+                if (descriptor >= 0)
+                {
+                        ::close(descriptor);
+                        shm_unlink(name.c_str());
+                        unlinked = false;
+                }
+        }
+        passed &= report("shared memory segments unlinked", unlinked);
+
+        std::cout << (passed ? "All distributed checks passed.\n" : "Some distributed checks failed.\n");
+        return passed ? 0 : 1;
+}
@@ -0,0 +1,175 @@
+// INFO: accuracy check of the fastmath kernels against the standard library evaluated in double.
+// INFO: every function is checked in FAST and FAITHFUL mode against the bound documented above its kernel,
+// INFO: the program exits with a non-zero status when any bound is exceeded. Run with make test.
+
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <random>
+#include <functional>
+#include <algorithm>
+
+#include "fastmath.hpp"
+
+#define TEST_SAMPLES 4'194'304 // INFO: random samples per domain, the documented bounds were measured with this count
+#define TEST_SEED 20'260'101
+
+enum class ErrorKind
+{
+        ULP,      // INFO: distance in units in the last place from the reference rounded to float
+        ABSOLUTE,
+        RELATIVE
+};
+
+using ArrayFunction = std::function<void(const float *, float *, uint64_t)>;
+using Reference = std::function<double(double)>;
+
+std::vector<float> uniformInputs(float low, float high)
+{
+        std::mt19937 generator(TEST_SEED);
+        std::uniform_real_distribution<float> distribution(low, high);
+        std::vector<float> result(TEST_SAMPLES);
+        for (float &value : result)
+                value = distribution(generator);
+        return result;
+}
+
+// INFO: positive normal floats with uniformly distributed bit patterns, so every binade is covered equally
+std::vector<float> positiveInputs()
+{
+        std::mt19937 generator(TEST_SEED);
+        std::uniform_int_distribution<int32_t> distribution(0x00800000, 0x7f7fffff);
+        std::vector<float> result(TEST_SAMPLES);
+        for (float &value : result)
+                value = mathFloat(distribution(generator));
+        return result;
+}
+
+double measureError(float value, double expected, ErrorKind kind)
+{
+        switch (kind)
+        {
+        case ErrorKind::ULP:
+                return static_cast<double>(ulpDistance(value, static_cast<float>(expected)));
+        case ErrorKind::ABSOLUTE:
+                return std::fabs(value - expected);
+        case ErrorKind::RELATIVE:
+                return std::fabs(value - expected) / std::fabs(expected);
+        }
+        return 0;
+}
+
+std::string formatError(double error, ErrorKind kind)
+{
+        // INFO: ulpDistance reports a NaN against a number as the largest uint64_t
+        if (!(error < 9.0e18))
+                return "NaN mismatch";
+        if (kind == ErrorKind::ULP)
+                return std::to_string(static_cast<uint64_t>(error)) + " ulp";
+        return "2^" + std::to_string(std::log2(error)) + ((kind == ErrorKind::ABSOLUTE) ? " absolute" : " relative");
+}
+
+// INFO: a NaN error (e.g. NaN against a finite reference) always counts as a failure
+bool check(const std::string &name, const ArrayFunction &function, const Reference &reference, const std::vector<float> &input, ErrorKind kind, double bound)
+{
+        std::vector<float> output(input.size());
+        function(input.data(), output.data(), input.size());
+        double worst = 0;
+        float worstInput = 0;
+        for (uint64_t i = 0; i < input.size(); i++)
+        {
+                double error = measureError(output[i], reference(input[i]), kind);
+                if (!(error <= worst))
+                {
+                        worst = error;
+                        worstInput = input[i];
+                }
+        }
+        bool passed = worst <= bound;
+        std::cout << (passed ? "PASS " : "FAIL ") << name << ": max " << formatError(worst, kind) << " at " << worstInput
+                  << ", bound " << formatError(bound, kind) << "\n";
+        return passed;
+}
+
+template <MathAccuracy Accuracy>
+ArrayFunction mode(void (*function)(const float *, float *, uint64_t, MathAccuracy))
+{
+        return [function](const float *input, float *output, uint64_t count) { function(input, output, count, Accuracy); };
+}
+
+// INFO: runs the in-place Storage overload of function on a copy of the input, as HeapArray and Tensor callers do
+template <MathAccuracy Accuracy>
+ArrayFunction inPlace(std::vector<float> &(*function)(std::vector<float> &, MathAccuracy))
+{
+        return [function](const float *input, float *output, uint64_t count)
+        {
+                std::vector<float> values(input, input + count);
+                function(values, Accuracy);
+                std::copy(values.begin(), values.end(), output);
+        };
+}
+
+int main()
+{
+        const double absolute23 = std::ldexp(1.0, -23);
+        std::vector<float> expInputs = uniformInputs(-87.0f, 88.0f);
+        std::vector<float> positive = positiveInputs();
+        std::vector<float> tanhInputs = uniformInputs(-10.0f, 10.0f);
+        std::vector<float> sigmoidInputs = uniformInputs(-80.0f, 80.0f);
+        std::vector<float> erfInputs = uniformInputs(-6.0f, 6.0f);
+        std::vector<float> trigSmall = uniformInputs(-4.0f, 4.0f);
+        std::vector<float> trigMedium = uniformInputs(-1024.0f, 1024.0f);
+        std::vector<float> trigLarge = uniformInputs(-MATH_TRIG_LIMIT, MATH_TRIG_LIMIT);
+        std::vector<float> trigHuge = uniformInputs(-1.0e30f, 1.0e30f);
+        trigHuge.push_back(std::numeric_limits<float>::infinity());
+        trigHuge.push_back(std::numeric_limits<float>::quiet_NaN());
+
+        Reference exp = [](double x) { return std::exp(x); };
+        Reference log = [](double x) { return std::log(x); };
+        Reference tanh = [](double x) { return std::tanh(x); };
+        Reference sigmoid = [](double x) { return 1.0/(1.0 + std::exp(-x)); };
+        Reference erf = [](double x) { return std::erf(x); };
+        Reference rsqrt = [](double x) { return 1.0/std::sqrt(x); };
+        Reference sin = [](double x) { return std::sin(x); };
+        Reference cos = [](double x) { return std::cos(x); };
+
+        bool passed = true;
+        passed &= check("exp FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastExp<float>), exp, expInputs, ErrorKind::ULP, 1);
+        passed &= check("exp FAST", mode<MathAccuracy::FAST>(fastExp<float>), exp, expInputs, ErrorKind::RELATIVE, std::ldexp(1.0, -14));
+        passed &= check("log FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastLog<float>), log, positive, ErrorKind::ULP, 1);
+        passed &= check("log FAST", mode<MathAccuracy::FAST>(fastLog<float>), log, positive, ErrorKind::ABSOLUTE, std::ldexp(1.0, -13));
+        passed &= check("tanh FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastTanh<float>), tanh, tanhInputs, ErrorKind::ULP, 1);
+        passed &= check("tanh FAST", mode<MathAccuracy::FAST>(fastTanh<float>), tanh, tanhInputs, ErrorKind::ABSOLUTE, std::ldexp(1.0, -16));
+        passed &= check("sigmoid FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastSigmoid<float>), sigmoid, sigmoidInputs, ErrorKind::ULP, 2);
+        passed &= check("sigmoid FAST", mode<MathAccuracy::FAST>(fastSigmoid<float>), sigmoid, sigmoidInputs, ErrorKind::RELATIVE, std::ldexp(1.0, -14));
+        passed &= check("erf FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastErf<float>), erf, erfInputs, ErrorKind::ULP, 3);
+        passed &= check("erf FAST", mode<MathAccuracy::FAST>(fastErf<float>), erf, erfInputs, ErrorKind::ABSOLUTE, std::ldexp(1.0, -14));
+        passed &= check("rsqrt FAITHFUL", mode<MathAccuracy::FAITHFUL>(fastRsqrt<float>), rsqrt, positive, ErrorKind::ULP, 1);
+        passed &= check("rsqrt FAST", mode<MathAccuracy::FAST>(fastRsqrt<float>), rsqrt, positive, ErrorKind::RELATIVE, std::ldexp(1.0, -17));
+        passed &= check("sin FAITHFUL |x| <= 4", mode<MathAccuracy::FAITHFUL>(fastSin<float>), sin, trigSmall, ErrorKind::ULP, 2);
+        passed &= check("cos FAITHFUL |x| <= 4", mode<MathAccuracy::FAITHFUL>(fastCos<float>), cos, trigSmall, ErrorKind::ULP, 2);
+        passed &= check("sin FAITHFUL |x| < limit", mode<MathAccuracy::FAITHFUL>(fastSin<float>), sin, trigLarge, ErrorKind::ABSOLUTE, absolute23);
+        passed &= check("cos FAITHFUL |x| < limit", mode<MathAccuracy::FAITHFUL>(fastCos<float>), cos, trigLarge, ErrorKind::ABSOLUTE, absolute23);
+        passed &= check("sin FAITHFUL |x| >= limit", mode<MathAccuracy::FAITHFUL>(fastSin<float>), [](double x) { return std::sin(static_cast<float>(x)); }, trigHuge, ErrorKind::ULP, 0);
+        passed &= check("cos FAITHFUL |x| >= limit", mode<MathAccuracy::FAITHFUL>(fastCos<float>), [](double x) { return std::cos(static_cast<float>(x)); }, trigHuge, ErrorKind::ULP, 0);
+        passed &= check("sin FAITHFUL in place |x| < limit", inPlace<MathAccuracy::FAITHFUL>(fastSin<std::vector<float>>), sin, trigLarge, ErrorKind::ABSOLUTE, absolute23);
+        passed &= check("cos FAITHFUL in place |x| < limit", inPlace<MathAccuracy::FAITHFUL>(fastCos<std::vector<float>>), cos, trigLarge, ErrorKind::ABSOLUTE, absolute23);
+        passed &= check("sin FAITHFUL in place |x| >= limit", inPlace<MathAccuracy::FAITHFUL>(fastSin<std::vector<float>>), [](double x) { return std::sin(static_cast<float>(x)); }, trigHuge, ErrorKind::ULP, 0);
+        passed &= check("cos FAITHFUL in place |x| >= limit", inPlace<MathAccuracy::FAITHFUL>(fastCos<std::vector<float>>), [](double x) { return std::cos(static_cast<float>(x)); }, trigHuge, ErrorKind::ULP, 0);
+        passed &= check("sin FAST |x| < 1024", mode<MathAccuracy::FAST>(fastSin<float>), sin, trigMedium, ErrorKind::ABSOLUTE, absolute23);
+        passed &= check("cos FAST |x| < 1024", mode<MathAccuracy::FAST>(fastCos<float>), cos, trigMedium, ErrorKind::ABSOLUTE, absolute23);
+
+        // INFO: the FAST pow bound grows with |exponent*log(base)|, which stays below powExponent*log(100) here
+        const float powExponent = 12.25f;
+        std::vector<float> powInputs = uniformInputs(0.01f, 100.0f);
+        Reference pow = [powExponent](double x) { return std::pow(x, static_cast<double>(powExponent)); };
+        ArrayFunction powFaithful = [powExponent](const float *input, float *output, uint64_t count) { fastPow(input, powExponent, output, count, MathAccuracy::FAITHFUL); };
+        ArrayFunction powFast = [powExponent](const float *input, float *output, uint64_t count) { fastPow(input, powExponent, output, count, MathAccuracy::FAST); };
+        passed &= check("pow FAITHFUL", powFaithful, pow, powInputs, ErrorKind::ULP, 1);
+        passed &= check("pow FAST", powFast, pow, powInputs, ErrorKind::RELATIVE, std::ldexp(1.0, -14) + std::ldexp(1.0, -22)*powExponent*std::log(100.0));
+
+        std::cout << (passed ? "All accuracy checks passed.\n" : "Some accuracy checks failed.\n");
+        return passed ? 0 : 1;
+}